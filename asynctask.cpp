@@ -0,0 +1,31 @@
+/*
+MIT License
+
+Copyright (c) 2020 Attila Csikós (attcs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Explicit instantiation unit of the common AsyncTasks (see ASYNCTASK_COMMON_TEMPLATES)
+// Compile it once into the project, and define ASYNCTASK_EXTERN_COMMON_TEMPLATES for the other translation units: they do not instantiate these tasks again.
+// Other combinations could be added by ASYNCTASK_INSTANTIATE_TEMPLATES(Progress, Result, Params...) here, and by ASYNCTASK_EXTERN_TEMPLATES() in a shared header.
+
+#include "asynctask.h"
+
+ASYNCTASK_COMMON_TEMPLATES(ASYNCTASK_INSTANTIATE_TEMPLATES)
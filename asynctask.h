@@ -22,12 +22,38 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#pragma once
+
+// Compile-time switches, they should be defined equally in every translation unit (e.g.: by the build system). Apart from <coroutine> and <span>, they trim the features, not the includes of the core:
+//  - ASYNCTASK_NO_PQ: AsyncTaskPQ, AsyncTaskPQRingBuffer, AsyncTaskStreaming and their queues are excluded.
+//  - ASYNCTASK_NO_MUTEX_STORAGE: the AsyncTask's mutex guarded progress storage is excluded, Progress types which would need it are rejected at compile time.
+//  - ASYNCTASK_NO_COROUTINE: AsyncTaskCo and the co_await support are excluded, <coroutine> is not included.
+//  - ASYNCTASK_NO_STATS: enableStats() is excluded, the tasks have no storage for the counters and their hooks are compiled out. getStats() returns std::nullopt.
+//  - ASYNCTASK_EXTERN_COMMON_TEMPLATES: the common AsyncTasks are not instantiated by the including translation units, asynctask.cpp should be linked (see ASYNCTASK_COMMON_TEMPLATES).
+// Optional facilities have their own headers, with their own includes: asynctask_cache.h (AsyncTaskResultCache), asynctask_trace.h (AsyncTaskChromeTraceSink) and asynctask_numa.h (AsyncTaskNumaTopology).
+
+#include "asynctask_fwd.h"
+
 #include <exception>
 #include <atomic>
 #include <mutex>
 #include <type_traits>
-#include <queue>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <optional>
+#include <limits>
+#include <memory_resource>
 
 #ifdef _MSC_VER
 #pragma warning(suppress : 4355)
@@ -36,10 +62,22 @@ SOFTWARE.
 #include <future>
 #endif
 
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>) && !defined(ASYNCTASK_NO_COROUTINE)
+#include <coroutine>
+#endif
+
+#if __has_include(<version>)
+#include <version>
+#endif
+
+#if defined(__cpp_lib_span) && !defined(ASYNCTASK_NO_PQ)
+#include <span>
+#endif
+
 class AsyncTaskIllegalStateException
 {
 public:
-  enum class eEx : int { TaskIsAlreadyRunning, TaskIsAlreadyFinished };
+  enum class eEx : int { TaskIsAlreadyRunning, TaskIsAlreadyFinished, TaskIsAlreadyChained };
 
   eEx e;
 
@@ -48,384 +86,4200 @@ public:
 };
 
 
-
-// AsyncTask 
-// Asynchronous task progress handler class
-//  - Asynchronous worker task should be defined into the doInBackground(), 
-//  - Feedback system elements should be handled by the onPreExecute()/onProgressUpdate()/onPostExecute()/onCancelled()
-//  - execute() start the doInBackground()
-//  - Refresh the feedback by the onCallbackLoop()
-// Nocopy object. onCallbackLoop() and get() could rethrow the doInBackground() thrown exceptions.
-template<typename Progress, typename Result, typename... Params>
-class AsyncTaskBase
+// Scheduling priority of the jobs, executors could run the higher ones first (e.g.: AsyncTaskThreadPool)
+enum class AsyncTaskPriority : int
 {
-public:
-  enum class Status : int
-  {
-    PENDING, // Indicates that the task has not been executed yet.
-    RUNNING, // Indicates that the task is running.
-    FINISHED // Indicates that the task is finished.
-  };
+  Background, // Bulk work, it runs only if there is no higher priority job
+  Normal,
+  Interactive // User-visible work, it jumps ahead of the others
+};
 
-private:
-  Status mStatus = Status::PENDING;
 
-  // Result handling
-  Result mResult{};
-  std::future<Result> mFuture{}; // Future is a non-copyable object so AsyncTask also.
+// Launch policy of the AsyncTaskBase::execute()
+enum class AsyncTaskLaunchPolicy : int
+{
+  Eager, // The job is submitted to the executor by the execute()
+  Deferred, // The job is submitted at the first demand of the main thread: onCallbackLoop(), dispatchCallbacks(), waitForUpdate(), get(), launch(), co_await or the AsyncTaskGroup's when*()
+  Speculative, // The job is submitted only if the executor has idle workers, on the Background priority. It is cancelled at its start or at its publishProgress() if other jobs are waiting for a worker.
+  Inline // The doInBackground() is run on the execute()'s thread, e.g.: for trivially small inputs. The progress storage does not block it (see detachProgress()).
+};
 
-  // Cancellation handling
-  std::atomic_bool atCancelled{};
 
-  // Exception handling
-  std::atomic_bool isExceptionRethrowNeededOnMainThread = { false };
-  std::exception_ptr eptr;
+// Placement hint of a job on the AsyncTaskThreadPool by the ids of its AsyncTaskWorkerLayout, other executors ignore it.
+// Non-exclusive jobs are queued at a preferred worker, but the idle workers could steal them (the workers of the same node first).
+struct AsyncTaskAffinity
+{
+  static size_t constexpr anyNode = std::numeric_limits<size_t>::max();
 
-public:
-  AsyncTaskBase() = default;
+  // Preferred NUMA node index of the layout, e.g.: where the data of the doInBackground() is allocated
+  size_t node = anyNode;
 
-protected:
-  AsyncTaskBase(AsyncTaskBase const&) = delete;
-  AsyncTaskBase(AsyncTaskBase&&) = delete;
-  AsyncTaskBase& operator=(AsyncTaskBase const&) = delete;
-  AsyncTaskBase& operator=(AsyncTaskBase&&) = delete;
-  virtual ~AsyncTaskBase() noexcept
-  {
-    auto const status = getStatus();
-    if (status != Status::RUNNING)
-      return;
+  // Preferred core ids of the layout, it overrides the node if it is not empty
+  std::vector<size_t> cores = {};
 
-    if (!this->isCancelled())
-      this->cancel();
+  // Only the selected preferred worker runs it (it is not stolen), e.g.: to serialize a task group on one worker
+  bool isExclusive = false;
 
-    if (!this->mFuture.valid())
-      return;
+  bool isAny() const noexcept { return node == anyNode && cores.empty(); }
+};
 
-    this->mFuture.wait();
-    // Exception rethrow: No. It could terminate the program if others already threw.
-  };
 
-public:
+// Scheduling attributes of the AsyncTaskBase::execute()
+struct AsyncTaskLaunchOptions
+{
+  AsyncTaskPriority priority = AsyncTaskPriority::Normal;
 
-  // Initiate the asynchronous task
-  // If the task is already began, AsyncTaskIllegalStateException will be thrown
-  // @MainThread
-  AsyncTaskBase<Progress, Result, Params...>& execute(Params const&... params) noexcept(false)
-  {
-    switch (mStatus)
-    {
-      case Status::PENDING: break; // Everything is ok.
-      case Status::RUNNING: throw AsyncTaskIllegalStateException(AsyncTaskIllegalStateException::eEx::TaskIsAlreadyRunning);
-      case Status::FINISHED: throw AsyncTaskIllegalStateException(AsyncTaskIllegalStateException::eEx::TaskIsAlreadyFinished);
-    }
+  // If the doInBackground() is not started until the deadline, the task is cancelled without the run of the doInBackground().
+  // A stepwise doInBackground() (see AsyncTaskCo) is started at its first step, the deadline does not interrupt its later steps.
+  std::optional<std::chrono::steady_clock::time_point> deadline;
 
-    this->mStatus = Status::RUNNING;
+  // Not launched Deferred and Speculative tasks are finished as cancelled without the run of the doInBackground().
+  AsyncTaskLaunchPolicy policy = AsyncTaskLaunchPolicy::Eager;
 
-    this->onPreExecute();
-    this->mFuture = std::async(std::launch::async,
-      [this](Params const&... params) -> Result
-      { 
-        if (isCancelled())
-          return {}; // Protect against undefined behavior, if Dtor is invoked before the - pure virtual function represented - task would be started
-
-        try 
-        { 
-          auto result = this->doInBackground(params...);
-          if (isCancelled())
-            return {};
-
-          return this->postResult(std::move(result));
-        }
-        catch (...)
-        {
-          cancel();
-          isExceptionRethrowNeededOnMainThread.store(true);
-          eptr = std::current_exception();
-        }
-        return {};
-      }, 
-      params...);
+  // Worker placement hint, if it is not given the task's setAffinity() is applied
+  AsyncTaskAffinity affinity = {};
+};
 
-    return *this;
-  }
 
-  // @MainThread
-  Status getStatus() const noexcept { return mStatus; }
+// Throttle of the AsyncTaskBase::publishProgress(): the redundant progress is dropped before it reaches the store mechanism.
+// A progress is stored if it passes every enabled filter, the first one is always stored.
+// The latest dropped progress is kept by copy (by move if it is published as rvalue) and it is stored after the doInBackground(), so the final value is always delivered.
+template<typename Progress>
+struct AsyncTaskProgressThrottle
+{
+  // At most one stored progress per interval, zero disables the time-based filter
+  std::chrono::steady_clock::duration minInterval = {};
 
-protected:
+  // Only if the measure of the progress is changed at least by minDelta since the last stored one, zero disables the delta-based filter
+  double minDelta = 0.0;
 
-  // Background worker task
-  // Exception can be thrown, it will be rethrown in get(), onCallbackLoop() or Dtor()
-  // @WorkerThread
-  virtual Result doInBackground(Params const&... params) = 0;
+  // Measure of the delta-based filter, arithmetic Progress is measured by its value if it is not set. E.g.: [](Progress const& p) { return double(p.iP); }
+  double(*fnMeasure)(Progress const&) = nullptr;
+};
 
-  // Define the store mechanism of the current state of the progress inside the class
-  // @WorkerThread
-  virtual void storeProgress(Progress const&) {}
 
-public:
-  // Store the current state of the progress inside the class
-  // Use inside the doInBackground()
-  // @WorkerThread
-  void publishProgress(Progress const& progress)
-  {
-    // doInBackground() could invoke publishProgress() during dtor(), so publishProgress() must be a non-virtual function and prevent to call virtual ones using isCancelled()
-    if (isCancelled())
-      return;
+// Worker-side reduction of the AsyncTaskPQ's progress items (see AsyncTaskPQBase::setProgressReduction())
+// Consecutive items are merged by combine() into an accumulator of the worker, it is queued if any enabled threshold is reached, and after the doInBackground().
+struct AsyncTaskProgressReduction
+{
+  // Queue the accumulator if this many items are merged into it, zero disables the count threshold
+  size_t maxItems = 0;
+
+  // Queue the accumulator at the first publishProgress() after this interval since its first item, zero disables the time threshold
+  std::chrono::steady_clock::duration maxInterval = {};
+};
 
-    this->storeProgress(progress);
-  }
 
+// AsyncTaskJob
+// Unit of work which is submitted to an AsyncTaskExecutor. AsyncTaskBase owns its job, no allocation is needed to submit it.
+class AsyncTaskJob
+{
 public:
-  // Post process result if it is needed, still on the worker thread
+  virtual ~AsyncTaskJob() = default;
+
+  // Executor must invoke it exactly once. The job object could be destroyed by its owner right after run() is returned.
   // @WorkerThread
-  virtual Result postResult(Result&& result) { return std::move(result); }
+  virtual void run() noexcept = 0;
 
-  // Usually to setup the feedback system
-  // @MainThread
-  virtual void onPreExecute() {}
+  // @MainThread or @WorkerThread, during the submit()
+  virtual AsyncTaskPriority getPriority() const noexcept { return AsyncTaskPriority::Normal; }
 
-  // Usually to declare the finishing in the feedback system
-  // @MainThread
-  virtual void onPostExecute(Result const&) {}
+  // nullptr: no placement hint
+  // @MainThread or @WorkerThread, during the submit()
+  virtual AsyncTaskAffinity const* getAffinity() const noexcept { return nullptr; }
+};
 
-  // Cleanup function if the task is canceled
-  // @MainThread
-  virtual void onCancelled() {}
 
-  // Cleanup function if the task is canceled
-  // @MainThread
-  virtual void onCancelled(Result const&) { onCancelled(); }
+// AsyncTaskExecutor
+// Executor concept of the AsyncTaskBase::execute(). It defines on which thread the doInBackground() will be run.
+//  - submit() must not block, and every submitted job must be run once (even if the executor is destructed meanwhile).
+class AsyncTaskExecutor
+{
+public:
+  virtual ~AsyncTaskExecutor() = default;
 
-protected:
-  virtual void handleProgress() = 0;
+  // @MainThread or @WorkerThread
+  virtual void submit(AsyncTaskJob& job) = 0;
 
-public:
-  // Returns true if the task is canceled by the cancel()
-  // It is usable to break process inside the doInBackground()
-  // @MainThread and @Workerthread
-  bool isCancelled() const noexcept { return atCancelled.load(std::memory_order_relaxed); }
+  // Number of the jobs which could run in parallel, e.g.: parallelFor() splits its work by it.
+  // @MainThread or @WorkerThread
+  virtual size_t getConcurrency() const noexcept { return std::max<size_t>(1, std::thread::hardware_concurrency()); }
 
-  // Cancel the task
-  // @MainThread
-  void cancel() noexcept { atCancelled.store(true, std::memory_order_relaxed); }
+  // Return true if submitted jobs are waiting for a free worker. A stepwise job (e.g.: AsyncTaskCo) gives its worker back between its steps only in this case.
+  // @WorkerThread
+  virtual bool hasPendingJobs() const noexcept { return false; }
 
-  // Get the result.
-  // It could freeze the mainthread if it invoked before the task is finished. Exception from the doInBackground can be rethrown.
-  //@MainThread
-  Result get()
-  {
-    if (getStatus() != Status::FINISHED)
-      finish(mFuture.get());
+  // Return true if a submitted job could be started right away, e.g.: AsyncTaskLaunchPolicy::Speculative tasks are launched only in this case.
+  // @MainThread or @WorkerThread
+  virtual bool hasIdleWorkers() const noexcept { return !hasPendingJobs(); }
 
-    return mResult;
-  }
+  // Executor of the parallelFor()'s helper jobs, e.g.: the thread executor hands them over to the shared thread pool instead of starting a thread for each.
+  // @WorkerThread
+  virtual AsyncTaskExecutor& getParallelExecutor() noexcept { return *this; }
+};
 
-  // Callback loop to refresh progress in the feedback system
-  // Return true if the task is finished. Exception from the doInBackground can be rethrown.
-  // @MainThread
-  bool onCallbackLoop()
+
+// AsyncTaskThreadExecutor: One new thread for every job, same as the std::async(std::launch::async, ...). This is the default executor, priority is not applied.
+class AsyncTaskThreadExecutor : public AsyncTaskExecutor
+{
+public:
+  void submit(AsyncTaskJob& job) override
   {
-    if (mStatus == Status::FINISHED)
-      return true;
+    std::thread([&job] { job.run(); }).detach();
+  }
 
-    if (mStatus == Status::PENDING || !mFuture.valid())
-      return false;
+  // AsyncTaskThreadPool::getDefault()
+  AsyncTaskExecutor& getParallelExecutor() noexcept override;
 
-    if (isCancelled())
-    {
-      finish(mFuture.get());
-      return true;
-    }
+  static AsyncTaskThreadExecutor& getDefault() noexcept
+  {
+    static AsyncTaskThreadExecutor executor;
+    return executor;
+  }
+};
 
-    auto const statusThread = mFuture.wait_for(std::chrono::seconds(0));
 
-    switch (statusThread)
-    {
-      case std::future_status::deferred:
-        return false;
+// AsyncTaskWorkerLayout: Worker placement of the AsyncTaskThreadPool, one worker per listed core, grouped by NUMA nodes
+//  - AsyncTaskAffinity refers to the node indices and the core ids of it.
+//  - If fnPin is not set, the workers are not pinned, the core ids only identify them.
+//  - The layout of the machine's NUMA nodes is detected by AsyncTaskNumaTopology::detect() of the asynctask_numa.h.
+struct AsyncTaskWorkerLayout
+{
+  // Core ids of every NUMA node
+  std::vector<std::vector<size_t>> nodes;
 
-      case std::future_status::timeout:
-        handleProgress();
-        return false;
+  // Invoked on every started worker thread with its core id, e.g.: AsyncTaskNumaTopology::pinCurrentThread
+  void(*fnPin)(size_t core) noexcept = nullptr;
 
-      case std::future_status::ready:
-        finish(mFuture.get());
-        return true;
+  // nWorker unpinned workers on one node, with the core ids 0..nWorker-1
+  static AsyncTaskWorkerLayout uniform(size_t nWorker)
+  {
+    auto layout = AsyncTaskWorkerLayout{};
+    layout.nodes.resize(1);
+    for (size_t core = 0; core < nWorker; ++core)
+      layout.nodes[0].push_back(core);
 
-      default:
-        return false;
-    }
+    return layout;
   }
+};
+
 
+// AsyncTaskThreadPool: Fixed-size work-stealing thread pool
+//  - Every worker has an own queue, idle workers steal from the others: from the workers of the same NUMA node first.
+//  - Jobs submitted from a worker thread are queued locally, except if their AsyncTaskAffinity prefers other workers.
+//  - Exclusive jobs (see AsyncTaskAffinity::isExclusive) are queued in a separate lane of their worker, others do not steal them.
+//  - Dtor runs the remaining queued jobs before the workers are joined.
+//  - Queues allocate from the memory resource given in the constructor, it must be thread-safe.
+//  - Every queue has a lane per AsyncTaskPriority: a higher priority job (in any worker's queue) is started before every lower one, the lower ones could be starved.
+class AsyncTaskThreadPool : public AsyncTaskExecutor
+{
 private:
-  // @MainThread
-  void finish(Result&& result)
+  static size_t constexpr nPriority = static_cast<size_t>(AsyncTaskPriority::Interactive) + 1;
+
+  struct Worker
   {
-    mResult = result;
-    if (isCancelled())
-      onCancelled(mResult);
-    else
-      onPostExecute(mResult);
+    using Lane = std::pmr::deque<AsyncTaskJob*>;
 
-    mStatus = Status::FINISHED;
+    std::mutex mutex;
+    std::array<Lane, nPriority> jobs; // By AsyncTaskPriority
+    std::array<Lane, nPriority> jobsExclusive; // By AsyncTaskPriority, they are not stolen
+    std::atomic<size_t> nExclusiveJobs = { 0 }; // Queued in jobsExclusive
+    std::vector<size_t> victims; // Steal order: the workers of the same node, then the others
+    size_t node = 0;
+    size_t core = 0;
+    std::thread thread;
 
-    if (isExceptionRethrowNeededOnMainThread.load() && eptr)
-      std::rethrow_exception(eptr);
-  }
-};
+    Worker(size_t node, size_t core, std::pmr::memory_resource* memoryResource)
+      : jobs{ Lane(memoryResource), Lane(memoryResource), Lane(memoryResource) }
+      , jobsExclusive{ Lane(memoryResource), Lane(memoryResource), Lane(memoryResource) }
+      , node(node), core(core)
+    {}
+  };
 
+  std::vector<std::unique_ptr<Worker>> mWorkers;
+  std::vector<std::vector<size_t>> mNodes; // Worker indices of every node
+  std::atomic<size_t> mNextWorker = { 0 };
+  std::atomic<size_t> mPendingJobs = { 0 };
+  std::atomic<size_t> mRunningJobs = { 0 };
+  std::atomic<size_t> mSharedJobs = { 0 }; // Queued in any stealable lane
 
-// General AsyncTask
-template<typename Progress, typename Result, typename... Params>
-class AsyncTask : public AsyncTaskBase<Progress, Result, Params...>
-{
-private:
-  // Progress handling
-  template<typename Data>
-  struct ThreadSafeContainer
+  std::mutex mSleepMutex;
+  std::condition_variable mSleepCondition;
+  bool mIsStopped = false;
+
+  struct CurrentWorker
   {
-  private:
-    Data mData{};
-    mutable std::mutex mMutex{};
+    AsyncTaskThreadPool const* pool = nullptr;
+    size_t index = 0;
+  };
+  static CurrentWorker& getCurrentWorker() noexcept
+  {
+    static thread_local CurrentWorker current;
+    return current;
+  }
 
-  public:
-    ThreadSafeContainer() = default;
-    ThreadSafeContainer(ThreadSafeContainer const&) = delete;
-    ThreadSafeContainer(ThreadSafeContainer&&) = delete;
-    ThreadSafeContainer& operator=(ThreadSafeContainer const&) = delete;
-    ThreadSafeContainer& operator=(ThreadSafeContainer&&) = delete;
+public:
+  explicit AsyncTaskThreadPool(size_t nThread = std::thread::hardware_concurrency(), std::pmr::memory_resource& memoryResource = *std::pmr::get_default_resource())
+    : AsyncTaskThreadPool(AsyncTaskWorkerLayout::uniform(std::max<size_t>(1, nThread)), memoryResource)
+  {}
 
-    void store(Data const& data)
-    {
-      std::unique_lock<std::mutex> lock(mMutex);
-      mData = data;
-    }
+  // Shared pool of hardware_concurrency() workers, it is created at the first use (e.g.: by the parallelFor() of the tasks on the AsyncTaskThreadExecutor)
+  static AsyncTaskThreadPool& getDefault() noexcept
+  {
+    static AsyncTaskThreadPool pool;
+    return pool;
+  }
 
-    Data load() const
-    {
-      Data data;
+  // Workers by the layout (e.g.: AsyncTaskNumaTopology::detect()), an empty layout has one unpinned worker
+  explicit AsyncTaskThreadPool(AsyncTaskWorkerLayout const& layout, std::pmr::memory_resource& memoryResource = *std::pmr::get_default_resource())
+  {
+    mNodes.resize(layout.nodes.size());
+    for (size_t iNode = 0; iNode < layout.nodes.size(); ++iNode)
+      for (auto const core : layout.nodes[iNode])
       {
-        std::unique_lock<std::mutex> lock(mMutex);
-        data = mData;
+        mNodes[iNode].push_back(mWorkers.size());
+        mWorkers.emplace_back(std::make_unique<Worker>(iNode, core, &memoryResource));
       }
-      return data;
+
+    if (mWorkers.empty())
+    {
+      mNodes.assign(1, { 0 });
+      mWorkers.emplace_back(std::make_unique<Worker>(0, 0, &memoryResource));
     }
-  };
 
-  static bool constexpr isProgressAtomicCompatible = std::is_trivially_copyable_v<Progress>
-    && std::is_copy_constructible_v<Progress>
-    && std::is_move_constructible_v<Progress>
-    && std::is_copy_assignable_v<Progress>
-    && std::is_move_assignable_v<Progress>;
+    auto const nWorker = mWorkers.size();
+    for (size_t iWorker = 0; iWorker < nWorker; ++iWorker)
+    {
+      auto& victims = mWorkers[iWorker]->victims;
+      victims.reserve(nWorker - 1);
+      for (size_t i = 1; i < nWorker; ++i)
+        if (mWorkers[(iWorker + i) % nWorker]->node == mWorkers[iWorker]->node)
+          victims.push_back((iWorker + i) % nWorker);
 
-  using ProgressContainer = typename std::conditional<isProgressAtomicCompatible
-    , std::atomic<Progress>
-    , ThreadSafeContainer<Progress>
-  >::type;
+      for (size_t i = 1; i < nWorker; ++i)
+        if (mWorkers[(iWorker + i) % nWorker]->node != mWorkers[iWorker]->node)
+          victims.push_back((iWorker + i) % nWorker);
+    }
 
-  ProgressContainer mProgress;
+    for (size_t i = 0; i < nWorker; ++i)
+      mWorkers[i]->thread = std::thread([this, i, fnPin = layout.fnPin] { workerLoop(i, fnPin); });
+  }
 
-protected:
+  AsyncTaskThreadPool(AsyncTaskThreadPool const&) = delete;
+  AsyncTaskThreadPool(AsyncTaskThreadPool&&) = delete;
+  AsyncTaskThreadPool& operator=(AsyncTaskThreadPool const&) = delete;
+  AsyncTaskThreadPool& operator=(AsyncTaskThreadPool&&) = delete;
 
-  // Store the current state of the progress inside the class
-  // @WorkerThread
-  void storeProgress(Progress const& progress) override
+  ~AsyncTaskThreadPool() noexcept
   {
-    this->mProgress.store(progress);
+    {
+      std::unique_lock<std::mutex> lock(mSleepMutex);
+      mIsStopped = true;
+    }
+    mSleepCondition.notify_all();
+
+    for (auto& worker : mWorkers)
+      worker->thread.join();
   }
 
-  // Show progress in the feedback system
-  // @MainThread
-  virtual void onProgressUpdate(Progress const&) {}
+  size_t size() const noexcept { return mWorkers.size(); }
 
-protected:
-  virtual void handleProgress() override final
+  size_t getNodeCount() const noexcept { return mNodes.size(); }
+
+  // Core id of the calling worker by the layout, nullopt if it is not a worker of this pool
+  std::optional<size_t> getCurrentCore() const noexcept
   {
-    this->onProgressUpdate(mProgress.load());
+    auto const& current = getCurrentWorker();
+    if (current.pool != this)
+      return std::nullopt;
+
+    return mWorkers[current.index]->core;
   }
 
-public:
-  using AsyncTaskBase<Progress, Result, Params...>::AsyncTaskBase;
-};
+  bool hasPendingJobs() const noexcept override { return mPendingJobs.load() > 0; }
 
+  bool hasIdleWorkers() const noexcept override { return mRunningJobs.load() + mPendingJobs.load() < mWorkers.size(); }
 
-// AsyncTaskPQ: AsyncTask using Progress Queue to handle progress queue in the proper order and handle every published progress item
-template<typename Progress, typename Result, typename... Params>
-class AsyncTaskPQ : public AsyncTaskBase<Progress, Result, Params...>
-{
-private:
-  // Progress handling
+  size_t getConcurrency() const noexcept override { return size(); }
+
+  void submit(AsyncTaskJob& job) override
+  {
+    auto const affinity = job.getAffinity();
+    auto const isExclusive = affinity && affinity->isExclusive;
+    {
+      auto& worker = *mWorkers[selectWorker(affinity)];
+      std::unique_lock<std::mutex> lock(worker.mutex);
+      mPendingJobs.fetch_add(1); // Before the push: the job could be popped right after the unlock, the count must not be behind the queues
+      try
+      {
+        (isExclusive ? worker.jobsExclusive : worker.jobs)[static_cast<size_t>(job.getPriority())].push_back(&job);
+      }
+      catch (...)
+      {
+        mPendingJobs.fetch_sub(1);
+        throw;
+      }
+      (isExclusive ? worker.nExclusiveJobs : mSharedJobs).fetch_add(1);
+    }
+
+    {
+      std::unique_lock<std::mutex> lock(mSleepMutex);
+    }
+
+    // Only its own worker could run an exclusive job
+    if (isExclusive)
+      mSleepCondition.notify_all();
+    else
+      mSleepCondition.notify_one();
+  }
+
+private:
+  size_t selectWorker(AsyncTaskAffinity const* affinity) noexcept
+  {
+    auto const& current = getCurrentWorker();
+    auto const isOnWorker = current.pool == this;
+    auto const nWorker = mWorkers.size();
+    if (affinity && !affinity->cores.empty())
+    {
+      auto const isPreferred = [&](size_t iWorker) { return std::find(affinity->cores.begin(), affinity->cores.end(), mWorkers[iWorker]->core) != affinity->cores.end(); };
+      if (isOnWorker && isPreferred(current.index))
+        return current.index;
+
+      auto const iStart = mNextWorker.fetch_add(1, std::memory_order_relaxed);
+      for (size_t i = 0; i < nWorker; ++i)
+        if (isPreferred((iStart + i) % nWorker))
+          return (iStart + i) % nWorker;
+    }
+    else if (affinity && affinity->node < mNodes.size() && !mNodes[affinity->node].empty())
+    {
+      if (isOnWorker && mWorkers[current.index]->node == affinity->node)
+        return current.index;
+
+      auto const& workers = mNodes[affinity->node];
+      return workers[mNextWorker.fetch_add(1, std::memory_order_relaxed) % workers.size()];
+    }
+
+    // Unknown cores and nodes are ignored
+    return isOnWorker ? current.index : mNextWorker.fetch_add(1, std::memory_order_relaxed) % nWorker;
+  }
+
+  AsyncTaskJob* popJob(size_t iWorker) noexcept
+  {
+    for (size_t iLane = nPriority; iLane-- > 0;)
+      if (auto const job = popJob(iWorker, iLane))
+        return job;
+
+    return nullptr;
+  }
+
+  AsyncTaskJob* popJob(size_t iWorker, size_t iLane) noexcept
+  {
+    // Own queues in FIFO order
+    {
+      auto& worker = *mWorkers[iWorker];
+      std::unique_lock<std::mutex> lock(worker.mutex);
+      if (auto& jobs = worker.jobsExclusive[iLane]; !jobs.empty())
+      {
+        auto const job = jobs.front();
+        jobs.pop_front();
+        worker.nExclusiveJobs.fetch_sub(1);
+        return job;
+      }
+
+      if (auto& jobs = worker.jobs[iLane]; !jobs.empty())
+      {
+        auto const job = jobs.front();
+        jobs.pop_front();
+        mSharedJobs.fetch_sub(1);
+        return job;
+      }
+    }
+
+    // Steal from the back of the others to reduce the contention with their owner
+    for (auto const iVictim : mWorkers[iWorker]->victims)
+    {
+      auto& worker = *mWorkers[iVictim];
+      auto& jobs = worker.jobs[iLane];
+      std::unique_lock<std::mutex> lock(worker.mutex);
+      if (!jobs.empty())
+      {
+        auto const job = jobs.back();
+        jobs.pop_back();
+        mSharedJobs.fetch_sub(1);
+        return job;
+      }
+    }
+
+    return nullptr;
+  }
+
+  void workerLoop(size_t iWorker, void(*fnPin)(size_t) noexcept) noexcept
+  {
+    getCurrentWorker() = { this, iWorker };
+    auto& worker = *mWorkers[iWorker];
+    if (fnPin)
+      fnPin(worker.core);
+
+    auto const isRunnable = [&] { return mSharedJobs.load() > 0 || worker.nExclusiveJobs.load() > 0; };
+    auto const isDrained = [&] { return mIsStopped && mPendingJobs.load() == 0 && mRunningJobs.load() == 0; }; // A running job could still submit exclusive jobs to others
+    for (;;)
+    {
+      if (auto const job = popJob(iWorker))
+      {
+        mRunningJobs.fetch_add(1);
+        mPendingJobs.fetch_sub(1);
+        job->run();
+        if (mRunningJobs.fetch_sub(1) == 1)
+        {
+          std::unique_lock<std::mutex> lock(mSleepMutex);
+          if (mIsStopped)
+            mSleepCondition.notify_all();
+        }
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(mSleepMutex);
+      mSleepCondition.wait(lock, [&] { return isRunnable() || isDrained(); });
+      if (isDrained())
+        return;
+    }
+  }
+};
+
+inline AsyncTaskExecutor& AsyncTaskThreadExecutor::getParallelExecutor() noexcept { return AsyncTaskThreadPool::getDefault(); }
+
+
+// AsyncTaskCancellationState: Cancellation flag of the AsyncTasks with wake-up
+//  - cancel() wakes up the waitFor()/waitUntil() of the AsyncTaskCancellationToken and invokes the registered AsyncTaskCancelCallbacks on the cancelling thread.
+//  - isCancelled() is a plain atomic load, it could be polled in loops.
+class AsyncTaskCancellationState
+{
+public:
+  // Intrusive list node of the AsyncTaskCancelCallbacks
+  class Node
+  {
+    friend class AsyncTaskCancellationState;
+
+    AsyncTaskCancellationState* mState = nullptr;
+    Node* mPrev = nullptr;
+    Node* mNext = nullptr;
+    bool mIsRegistered = false;
+    void(*fnInvoke)(Node*) noexcept = nullptr;
+
+  protected:
+    explicit Node(void(*fnInvoke)(Node*) noexcept) noexcept : fnInvoke(fnInvoke) {}
+    ~Node() = default;
+
+    // It should be invoked by the derived class' Ctor, it invokes the callback immediately if the state is already cancelled.
+    void registerAt(AsyncTaskCancellationState* state) noexcept
+    {
+      if (state)
+        state->add(*this);
+    }
+
+    // It should be invoked by the derived class' Dtor, it waits for the callback if it is invoked by another thread.
+    void deregister() noexcept
+    {
+      if (mState)
+        mState->remove(*this);
+    }
+  };
+
+private:
+  std::atomic_bool mIsCancelled = { false };
+  mutable std::mutex mMutex;
+  mutable std::condition_variable mCondition;
+  Node* mCallbacks = nullptr; // Guarded by mMutex
+  Node* mCallbackInvoked = nullptr; // Guarded by mMutex
+  std::thread::id mInvokerThread; // Guarded by mMutex
+
+public:
+  AsyncTaskCancellationState() = default;
+  AsyncTaskCancellationState(AsyncTaskCancellationState const&) = delete;
+  AsyncTaskCancellationState(AsyncTaskCancellationState&&) = delete;
+  AsyncTaskCancellationState& operator=(AsyncTaskCancellationState const&) = delete;
+  AsyncTaskCancellationState& operator=(AsyncTaskCancellationState&&) = delete;
+
+  bool isCancelled() const noexcept { return mIsCancelled.load(std::memory_order_acquire); }
+
+  // Return false if it is already cancelled
+  bool cancel() noexcept
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (mIsCancelled.exchange(true, std::memory_order_acq_rel))
+      return false;
+
+    mCondition.notify_all();
+
+    mInvokerThread = std::this_thread::get_id();
+    while (auto const node = mCallbacks)
+    {
+      unlink(*node);
+      mCallbackInvoked = node;
+      lock.unlock();
+      node->fnInvoke(node);
+      lock.lock();
+      mCallbackInvoked = nullptr;
+      mCondition.notify_all();
+    }
+    return true;
+  }
+
+  // Registered callbacks are kept
+  void reset() noexcept
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mIsCancelled.store(false, std::memory_order_release);
+  }
+
+  // Return true if it is cancelled before the deadline
+  template<typename Clock, typename Duration>
+  bool waitUntil(std::chrono::time_point<Clock, Duration> const& deadline) const
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    return mCondition.wait_until(lock, deadline, [this] { return isCancelled(); });
+  }
+
+private:
+  void add(Node& node) noexcept
+  {
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      if (!isCancelled())
+      {
+        node.mState = this;
+        node.mIsRegistered = true;
+        node.mNext = mCallbacks;
+        if (mCallbacks)
+          mCallbacks->mPrev = &node;
+
+        mCallbacks = &node;
+        return;
+      }
+    }
+    node.fnInvoke(&node);
+  }
+
+  void remove(Node& node) noexcept
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (node.mIsRegistered)
+      return unlink(node);
+
+    if (mInvokerThread != std::this_thread::get_id()) // The callback could destroy itself
+      mCondition.wait(lock, [this, &node] { return mCallbackInvoked != &node; });
+  }
+
+  void unlink(Node& node) noexcept
+  {
+    if (node.mPrev)
+      node.mPrev->mNext = node.mNext;
+    else
+      mCallbacks = node.mNext;
+
+    if (node.mNext)
+      node.mNext->mPrev = node.mPrev;
+
+    node.mPrev = node.mNext = nullptr;
+    node.mIsRegistered = false;
+  }
+};
+
+
+// AsyncTaskCancellationToken: Non-owning view of an AsyncTaskCancellationState (like std::stop_token), e.g.: AsyncTaskBase::getCancellationToken()
+// The default constructed token is never cancelled.
+class AsyncTaskCancellationToken
+{
+private:
+  AsyncTaskCancellationState* mState = nullptr;
+
+public:
+  AsyncTaskCancellationToken() noexcept = default;
+  explicit AsyncTaskCancellationToken(AsyncTaskCancellationState& state) noexcept : mState(&state) {}
+
+  bool isCancelled() const noexcept { return mState && mState->isCancelled(); }
+
+  // Sleep until the deadline, but it returns immediately at the cancellation. Return true if it is cancelled.
+  template<typename Clock, typename Duration>
+  bool waitUntil(std::chrono::time_point<Clock, Duration> const& deadline) const
+  {
+    if (mState)
+      return mState->waitUntil(deadline);
+
+    std::this_thread::sleep_until(deadline);
+    return false;
+  }
+
+  // Sleep for the duration, but it returns immediately at the cancellation. Return true if it is cancelled.
+  template<typename Rep, typename Period>
+  bool waitFor(std::chrono::duration<Rep, Period> const& duration) const
+  {
+    return waitUntil(std::chrono::steady_clock::now() + duration);
+  }
+
+  AsyncTaskCancellationState* getState() const noexcept { return mState; }
+};
+
+
+// AsyncTaskCancelCallback: Scoped callback registration (like std::stop_callback), the callback is invoked by the cancel() on the cancelling thread.
+//  - If the token is already cancelled, the callback is invoked immediately in the Ctor.
+//  - Dtor deregisters the callback, if it is running on another thread meanwhile, the Dtor waits for it.
+// It is usable to interrupt blocking waits in the doInBackground(), e.g.: notifying a condition variable or closing a socket. The callback must not throw.
+template<typename Callback>
+class AsyncTaskCancelCallback final : private AsyncTaskCancellationState::Node
+{
+private:
+  Callback mCallback;
+
+  static void invoke(AsyncTaskCancellationState::Node* node) noexcept { static_cast<AsyncTaskCancelCallback*>(node)->mCallback(); }
+
+public:
+  template<typename CallbackT>
+  AsyncTaskCancelCallback(AsyncTaskCancellationToken const& token, CallbackT&& callback)
+    : AsyncTaskCancellationState::Node(&AsyncTaskCancelCallback::invoke)
+    , mCallback(std::forward<CallbackT>(callback))
+  {
+    this->registerAt(token.getState());
+  }
+
+  AsyncTaskCancelCallback(AsyncTaskCancelCallback const&) = delete;
+  AsyncTaskCancelCallback(AsyncTaskCancelCallback&&) = delete;
+  AsyncTaskCancelCallback& operator=(AsyncTaskCancelCallback const&) = delete;
+  AsyncTaskCancelCallback& operator=(AsyncTaskCancelCallback&&) = delete;
+
+  ~AsyncTaskCancelCallback() noexcept { this->deregister(); }
+};
+
+template<typename Callback>
+AsyncTaskCancelCallback(AsyncTaskCancellationToken const&, Callback) -> AsyncTaskCancelCallback<Callback>;
+
+
+// AsyncTaskParallelFor: Shared state of the AsyncTaskBase::parallelFor()
+//  - Chunks of grainSize indices are claimed by the calling worker and by the helper jobs on the executor.
+//  - Every participant counts its own finished indices in a separate cache line, only the calling worker merges them for the progress report.
+//  - Late helper jobs (started after the loop is finished) do not touch the loop body, they only keep this state alive until their end.
+class AsyncTaskParallelFor
+{
+public:
+  using Body = void(*)(void*, size_t);
+
+private:
+  static size_t constexpr nCacheLine = 64;
+
+  struct alignas(nCacheLine) Counter
+  {
+    std::atomic<size_t> n = { 0 };
+  };
+
+  struct Helper final : public AsyncTaskJob
+  {
+    AsyncTaskParallelFor* loop = nullptr;
+    std::shared_ptr<AsyncTaskParallelFor> keepAlive;
+    size_t iParticipant = 0;
+
+    Helper(AsyncTaskParallelFor* loop, size_t iParticipant) noexcept : loop(loop), iParticipant(iParticipant) {}
+
+    void run() noexcept override
+    {
+      auto const keepAliveOfRun = std::move(keepAlive); // The state (and this job) could be destroyed at the end of the run
+      loop->runHelper(iParticipant);
+    }
+
+    AsyncTaskPriority getPriority() const noexcept override { return loop->mPriority; }
+  };
+
+  size_t const mEnd;
+  size_t const mGrainSize;
+  AsyncTaskCancellationToken const mToken;
+  AsyncTaskPriority const mPriority;
+  void* const mBody;
+  Body const fnBody;
+
+  alignas(nCacheLine) std::atomic<size_t> mNext;
+  std::atomic<size_t> mActive = { 0 };
+  std::atomic_bool mIsStopped = { false };
+
+  std::mutex mMutex;
+  std::condition_variable mCondition;
+  std::exception_ptr mEptr; // Guarded by mMutex
+
+  std::pmr::vector<Counter> mCounters;
+  std::pmr::vector<Helper> mHelpers;
+
+public:
+  AsyncTaskParallelFor(size_t begin, size_t end, size_t grainSize, size_t nHelper, AsyncTaskCancellationToken const& token, AsyncTaskPriority priority, void* body, Body fnBody, std::pmr::memory_resource& memoryResource)
+    : mEnd(end), mGrainSize(grainSize), mToken(token), mPriority(priority), mBody(body), fnBody(fnBody), mNext(begin)
+    , mCounters(nHelper + 1, &memoryResource), mHelpers(&memoryResource)
+  {
+    mHelpers.reserve(nHelper);
+    for (size_t i = 0; i < nHelper; ++i)
+      mHelpers.emplace_back(this, i + 1);
+  }
+
+  AsyncTaskParallelFor(AsyncTaskParallelFor const&) = delete;
+  AsyncTaskParallelFor(AsyncTaskParallelFor&&) = delete;
+  AsyncTaskParallelFor& operator=(AsyncTaskParallelFor const&) = delete;
+  AsyncTaskParallelFor& operator=(AsyncTaskParallelFor&&) = delete;
+
+  // Submit the helpers, the failed submissions are skipped
+  // @WorkerThread
+  static void start(std::shared_ptr<AsyncTaskParallelFor> const& loop, AsyncTaskExecutor& executor) noexcept
+  {
+    for (auto& helper : loop->mHelpers)
+    {
+      helper.keepAlive = loop;
+      try
+      {
+        executor.submit(helper);
+      }
+      catch (...)
+      {
+        helper.keepAlive.reset();
+      }
+    }
+  }
+
+  // Process the chunks on the calling worker, and wait for the helpers. fnReport(nDone) is invoked on the calling worker if the number of the processed indices is changed.
+  // Exception of the loop body is rethrown after every helper is finished with its chunk. Return false if the loop is stopped by cancellation or exception.
+  // @WorkerThread
+  template<typename Report>
+  bool run(Report&& fnReport)
+  {
+    size_t nReported = 0;
+    auto const report = [&]
+    {
+      auto const nDone = getDone();
+      if (nDone == nReported)
+        return;
+
+      nReported = nDone;
+      fnReport(nDone);
+    };
+
+    try
+    {
+      while (runChunk(0))
+        report();
+
+      std::unique_lock<std::mutex> lock(mMutex);
+      while (mActive.load() > 0)
+      {
+        if (mCondition.wait_for(lock, std::chrono::milliseconds(10), [this] { return mActive.load() == 0; }))
+          break;
+
+        lock.unlock();
+        report();
+        lock.lock();
+      }
+    }
+    catch (...)
+    {
+      setException(std::current_exception());
+      waitHelpers();
+      throw;
+    }
+
+    if (mEptr)
+      std::rethrow_exception(mEptr);
+
+    report();
+    return !mIsStopped.load();
+  }
+
+private:
+  // @WorkerThread
+  size_t getDone() const noexcept
+  {
+    size_t nDone = 0;
+    for (auto const& counter : mCounters)
+      nDone += counter.n.load(std::memory_order_acquire);
+
+    return nDone;
+  }
+
+  // @WorkerThread
+  void runHelper(size_t iParticipant) noexcept
+  {
+    mActive.fetch_add(1); // Before the claim: the calling worker does not return while a claimed chunk is processed
+    while (runChunk(iParticipant));
+
+    if (mActive.fetch_sub(1) == 1)
+    {
+      {
+        std::unique_lock<std::mutex> lock(mMutex);
+      }
+      mCondition.notify_all();
+    }
+  }
+
+  // Return false if there is no more chunk or the loop is stopped
+  // @WorkerThread
+  bool runChunk(size_t iParticipant) noexcept
+  {
+    auto const iBegin = mNext.fetch_add(mGrainSize);
+    if (iBegin >= mEnd)
+      return false;
+
+    auto const iEnd = std::min(mEnd, iBegin + mGrainSize);
+    auto i = iBegin;
+    try
+    {
+      for (; i < iEnd && !isStopped(); ++i)
+        fnBody(mBody, i);
+    }
+    catch (...)
+    {
+      setException(std::current_exception());
+    }
+
+    auto& counter = mCounters[iParticipant].n;
+    counter.store(counter.load(std::memory_order_relaxed) + (i - iBegin), std::memory_order_release);
+    return i == iEnd;
+  }
+
+  bool isStopped() noexcept
+  {
+    if (mIsStopped.load(std::memory_order_relaxed))
+      return true;
+
+    if (!mToken.isCancelled())
+      return false;
+
+    stop();
+    return true;
+  }
+
+  void stop() noexcept
+  {
+    mIsStopped.store(true);
+    mNext.store(mEnd); // Unclaimed chunks are dropped
+  }
+
+  void setException(std::exception_ptr eptr) noexcept
+  {
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      if (!mEptr)
+        mEptr = std::move(eptr);
+    }
+    stop();
+  }
+
+  void waitHelpers() noexcept
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCondition.wait(lock, [this] { return mActive.load() == 0; });
+  }
+};
+
+
+// Timing and counters of a task's run, collected if it is enabled by AsyncTaskBase::enableStats()
+struct AsyncTaskStats
+{
+  using Clock = std::chrono::steady_clock;
+
+  Clock::time_point tExecute{}; // execute(), or the hand-over of the previous task's result at then()
+  Clock::time_point tStart{}; // Worker started the run
+  Clock::time_point tFinish{}; // Worker set the result
+  Clock::time_point tDispatch{}; // onPostExecute()/onCancelled() on the main thread
+
+  uint64_t nPublished = 0; // publishProgress() calls
+  uint64_t nThrottled = 0; // Dropped by the throttle (see setProgressThrottle())
+  uint64_t nStored = 0; // Passed to the progress storage
+  uint64_t nCoalesced = 0; // Merged into the last queued item by isLastShouldBeAltered(), or into the worker's accumulator by combine() (AsyncTaskPQ)
+  uint64_t nDropped = 0; // Dropped by the progress queue: overflow of DropOldest, or interrupted wait of Block/Coalesce (AsyncTaskPQ)
+  uint64_t nQueueHighWater = 0; // Maximal length of the progress queue (AsyncTaskPQ)
+
+  Clock::duration getWaitTime() const noexcept { return tStart - tExecute; }
+  Clock::duration getRunTime() const noexcept { return tFinish - tStart; }
+  Clock::duration getDispatchDelay() const noexcept { return tDispatch - tFinish; }
+};
+
+
+// Receiver of the stats, e.g.: to export them to tracing tools (see AsyncTaskChromeTraceSink of the asynctask_trace.h)
+class AsyncTaskTraceSink
+{
+public:
+  virtual ~AsyncTaskTraceSink() = default;
+
+  // Invoked at the finish of every run of the tasks which are registered by enableStats(), after their onPostExecute()/onCancelled().
+  // @MainThread
+  virtual void onTaskFinished(void const* task, AsyncTaskStats const& stats) noexcept = 0;
+};
+
+
+// Outcome of the progress queue's store(), it feeds the AsyncTaskStats
+struct AsyncTaskProgressStoreResult
+{
+  size_t nQueued = 0; // Length of the queue after the store
+  bool isCoalesced = false; // Merged into the last item by isLastShouldBeAltered()
+  size_t nDropped = 0; // Number of the dropped items: the oldest one at DropOldest overflow, or the new one if the wait of Block/Coalesce is interrupted
+};
+
+
+template<typename T, typename = void>
+struct AsyncTaskIsEqualityComparable : std::false_type {};
+
+template<typename T>
+struct AsyncTaskIsEqualityComparable<T, std::void_t<decltype(std::declval<T const&>() == std::declval<T const&>())>> : std::true_type {};
+
+
+// Interface of the result caches, the tasks refer their cache through it (see AsyncTaskResultCache of the asynctask_cache.h)
+// The implementation must be thread-safe and it must outlive its tasks.
+template<typename Result, typename... Params>
+class AsyncTaskResultCacheBase
+{
+public:
+  using Key = std::tuple<Params...>;
+
+  enum class Acquisition : int
+  {
+    Hit, // Result is copied from the cache
+    Wait, // Waiter is registered for the Result of the in-flight computation
+    Lead // Computation should be started, the Result is expected by complete() or abandon()
+  };
+
+  // Registered task which waits for the in-flight Result, fnResume is invoked with the Result, or with nullptr if it should take over the computation
+  struct Waiter
+  {
+    void* task = nullptr;
+    void(*fnResume)(void* task, Result const* result) noexcept = nullptr;
+  };
+
+  virtual ~AsyncTaskResultCacheBase() = default;
+
+  // Look up the key: copy the cached Result into the resultHit, or register the waiter, or expect the computation from the caller
+  virtual Acquisition acquire(Key const& key, Waiter const& waiter, std::optional<Result>& resultHit) noexcept(false) = 0;
+
+  // The computation of the key is finished: the Result is cached and the waiters are resumed with it
+  virtual void complete(Key const& key, Result const& result) noexcept = 0;
+
+  // The computation of the key is cancelled or failed: the first waiter takes over it
+  virtual void abandon(Key const& key) noexcept = 0;
+
+  // Unregister the waiter (e.g.: it is cancelled), return false if it is already resumed
+  virtual bool detach(Key const& key, void const* task) noexcept = 0;
+};
+
+
+// AsyncTaskProgressBroadcast: Fan-out of the tasks' progress to many observers (see AsyncTaskBase::setProgressBroadcast())
+//  - Every stored progress is copied once into a shared immutable snapshot, every observer gets the same std::shared_ptr<Progress const>.
+//  - The snapshots are kept in a ring of the given capacity, every Subscription has its own cursor into it. The publisher never waits for the observers:
+//    a slow observer skips the overwritten snapshots, their number is counted by its getDroppedCount().
+//  - Thread-safe: observers could poll or wait on different threads, one Subscription is used by one thread. The broadcast must outlive its subscriptions.
+template<typename Progress>
+class AsyncTaskProgressBroadcast
+{
+public:
+  using Snapshot = std::shared_ptr<Progress const>;
+
+  class Subscription
+  {
+    friend class AsyncTaskProgressBroadcast;
+
+    AsyncTaskProgressBroadcast const* mBroadcast = nullptr;
+    uint64_t mCursor = 0; // Sequence of the next snapshot
+    uint64_t mDropped = 0;
+    std::vector<Snapshot> mBatch; // Its capacity is reused by the poll()
+
+    Subscription(AsyncTaskProgressBroadcast const* broadcast, uint64_t cursor) noexcept : mBroadcast(broadcast), mCursor(cursor) {}
+
+  public:
+    // Invoke fn(Snapshot const&) for at most nMax snapshots after the cursor in the published order, outside of the broadcast's lock.
+    // Return the number of the handled snapshots.
+    template<typename Fn>
+    size_t poll(Fn&& fn, size_t nMax = std::numeric_limits<size_t>::max())
+    {
+      mBatch.clear();
+      mBroadcast->take(*this, nMax);
+      for (auto const& snapshot : mBatch)
+        fn(snapshot);
+
+      auto const nHandled = mBatch.size();
+      mBatch.clear(); // The snapshots are not kept alive by the subscription
+      return nHandled;
+    }
+
+    // Block until a snapshot is published after the cursor, or the timeout is expired. Return true if there is a new snapshot.
+    template<typename Rep, typename Period>
+    bool waitFor(std::chrono::duration<Rep, Period> const& timeout) const
+    {
+      return mBroadcast->waitUntil(mCursor, std::chrono::steady_clock::now() + timeout);
+    }
+
+    size_t getPendingCount() const { return mBroadcast->getPendingCount(mCursor); }
+
+    // Number of the snapshots which are overwritten before this subscription could poll them
+    uint64_t getDroppedCount() const noexcept { return mDropped; }
+  };
+
+private:
+  mutable std::mutex mMutex;
+  mutable std::condition_variable mCondition;
+  mutable std::atomic<int> mWaiterCount = { 0 };
+  std::pmr::vector<Snapshot> mRing; // Guarded by mMutex
+  uint64_t mEnd = 0; // Guarded by mMutex: number of the published snapshots
+  std::pmr::polymorphic_allocator<Progress> mAllocator;
+
+public:
+  // The snapshots are allocated from the memory resource, it must be thread-safe.
+  explicit AsyncTaskProgressBroadcast(size_t capacity = 64, std::pmr::memory_resource& memoryResource = *std::pmr::get_default_resource())
+    : mRing(std::max<size_t>(1, capacity), &memoryResource), mAllocator(&memoryResource)
+  {}
+
+  AsyncTaskProgressBroadcast(AsyncTaskProgressBroadcast const&) = delete;
+  AsyncTaskProgressBroadcast(AsyncTaskProgressBroadcast&&) = delete;
+  AsyncTaskProgressBroadcast& operator=(AsyncTaskProgressBroadcast const&) = delete;
+  AsyncTaskProgressBroadcast& operator=(AsyncTaskProgressBroadcast&&) = delete;
+
+  // New subscription from the next snapshot, the earlier ones are available by getLatest()
+  Subscription subscribe() const
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    return Subscription(this, mEnd);
+  }
+
+  // The newest snapshot, nullptr if nothing is published yet
+  Snapshot getLatest() const
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    return mEnd == 0 ? nullptr : mRing[(mEnd - 1) % mRing.size()];
+  }
+
+  // @WorkerThread: invoked by the task at every stored progress
+  void publish(Progress const& progress)
+  {
+    Snapshot snapshot = std::allocate_shared<Progress>(mAllocator, progress); // Allocated and copied outside of the lock
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mRing[mEnd % mRing.size()].swap(snapshot);
+      ++mEnd;
+    }
+
+    if (mWaiterCount.load() > 0)
+      mCondition.notify_all();
+    // The overwritten snapshot is released here, outside of the lock
+  }
+
+private:
+  void take(Subscription& subscription, size_t nMax) const
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    auto const begin = mEnd > mRing.size() ? mEnd - mRing.size() : 0;
+    if (subscription.mCursor < begin)
+    {
+      subscription.mDropped += begin - subscription.mCursor;
+      subscription.mCursor = begin;
+    }
+
+    auto const n = static_cast<size_t>(std::min<uint64_t>(nMax, mEnd - subscription.mCursor));
+    for (size_t i = 0; i < n; ++i)
+      subscription.mBatch.push_back(mRing[(subscription.mCursor + i) % mRing.size()]);
+
+    subscription.mCursor += n;
+  }
+
+  size_t getPendingCount(uint64_t cursor) const
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    return static_cast<size_t>(std::min<uint64_t>(mRing.size(), mEnd - cursor));
+  }
+
+  bool waitUntil(uint64_t cursor, std::chrono::steady_clock::time_point const& deadline) const
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mWaiterCount.fetch_add(1);
+    auto const isPublished = mCondition.wait_until(lock, deadline, [&] { return mEnd != cursor; });
+    mWaiterCount.fetch_sub(1);
+    return isPublished;
+  }
+};
+
+
+// AsyncTask 
+// Asynchronous task progress handler class
+//  - Asynchronous worker task should be defined into the doInBackground(), 
+//  - Feedback system elements should be handled by the onPreExecute()/onProgressUpdate()/onPostExecute()/onCancelled()
+//  - execute() start the doInBackground()
+//  - Refresh the feedback by the onCallbackLoop()
+// Nocopy object. onCallbackLoop() and get() could rethrow the doInBackground() thrown exceptions.
+// The doInBackground() is run by the AsyncTaskExecutor given in the constructor (default: one new thread per execute()).
+template<typename Progress, typename Result, typename... Params>
+class AsyncTaskBase
+{
+  template<typename, typename, typename...> friend class AsyncTaskBase; // then() reaches the next task's continuation interface
+
+public:
+  enum class Status : int
+  {
+    PENDING, // Indicates that the task has not been executed yet.
+    RUNNING, // Indicates that the task is running.
+    FINISHED // Indicates that the task is finished.
+  };
+
+private:
+  Status mStatus = Status::PENDING;
+
+  // Executor handling
+  struct Job final : public AsyncTaskJob
+  {
+    AsyncTaskBase* task = nullptr;
+    Job(AsyncTaskBase* task) : task(task) {}
+    void run() noexcept override { task->runInBackground(); }
+    AsyncTaskPriority getPriority() const noexcept override { return task->mLaunchOptions.priority; }
+    AsyncTaskAffinity const* getAffinity() const noexcept override { return task->mLaunchOptions.affinity.isAny() ? &task->mAffinity : &task->mLaunchOptions.affinity; }
+  };
+
+  AsyncTaskExecutor* mExecutor = nullptr;
+  AsyncTaskLaunchOptions mLaunchOptions{};
+  AsyncTaskAffinity mAffinity{}; // If the launch options do not give it
+  std::atomic_bool isLaunchDeferred = { false }; // Deferred task waits for its launch(), cancel() could clear it on the worker too
+  std::pmr::memory_resource* mMemoryResource = nullptr;
+  Job mJob{ this };
+  bool isBackgroundStarted = false; // Set by the worker at the first runInBackground() of the run, armResult() clears it
+  std::optional<std::tuple<Params...>> mParams{};
+
+  // Result handling
+  Result mResult{};
+  std::optional<std::promise<Result>> mPromise{};
+  std::future<Result> mFuture{}; // Future is a non-copyable object so AsyncTask also.
+
+  // Progress throttle handling, its state is used only by the publishing worker
+  AsyncTaskProgressThrottle<Progress> mThrottle{};
+  std::chrono::steady_clock::time_point mThrottleStoredAt{};
+  double mThrottleStoredMeasure = 0.0;
+  bool isThrottleEnabled = false;
+  bool isThrottleStored = false;
+  bool isProgressThrottled = false;
+  std::optional<Progress> mProgressThrottled{}; // The latest dropped progress, the storage is kept for reuse
+  bool isProgressHeldBack = false; // The store mechanism kept the last progress on the worker, the main thread is not notified
+  AsyncTaskProgressBroadcast<Progress>* mProgressBroadcast = nullptr;
+
+  // Cancellation handling
+  AsyncTaskCancellationState mCancellation;
+
+  // Instrumentation handling, the counters are constructed in place only if the stats are enabled.
+  // Disabled stats cost the storage of the counters and a branch per hook, ASYNCTASK_NO_STATS removes both.
+  struct StatsCounters
+  {
+    std::atomic<AsyncTaskStats::Clock::rep> tExecute = { 0 };
+    std::atomic<AsyncTaskStats::Clock::rep> tStart = { 0 };
+    std::atomic<AsyncTaskStats::Clock::rep> tFinish = { 0 };
+    std::atomic<AsyncTaskStats::Clock::rep> tDispatch = { 0 };
+    std::atomic<uint64_t> nPublished = { 0 };
+    std::atomic<uint64_t> nThrottled = { 0 };
+    std::atomic<uint64_t> nStored = { 0 };
+    std::atomic<uint64_t> nCoalesced = { 0 };
+    std::atomic<uint64_t> nDropped = { 0 };
+    std::atomic<uint64_t> nQueueHighWater = { 0 };
+  };
+#ifndef ASYNCTASK_NO_STATS
+  std::optional<StatsCounters> mStats{};
+  AsyncTaskTraceSink* mTraceSink = nullptr;
+#else
+  // Always empty: the hooks' branches are folded at compile time, and it has no storage in the tasks
+  struct NoStatsCounters
+  {
+    constexpr explicit operator bool() const noexcept { return false; }
+    constexpr StatsCounters* operator->() const noexcept { return nullptr; }
+    constexpr void emplace() const noexcept {}
+  };
+  static NoStatsCounters constexpr mStats{};
+#endif
+
+  // Exception handling
+  std::atomic_bool isExceptionRethrowNeededOnMainThread = { false };
+  std::exception_ptr eptr;
+
+  // Update notification handling
+  std::mutex mUpdateMutex;
+  std::condition_variable mUpdateCondition;
+  std::atomic<uint64_t> mUpdateCount = { 0 }; // Number of the published progress, cancellation and finish events
+  std::atomic<int> mUpdateWaiterCount = { 0 };
+  uint64_t mUpdateCountHandled = 0; // @MainThread
+  std::function<void()> fnWakeUp;
+  std::atomic_bool isWakeUpSignaled = { false };
+  AsyncTaskJob* mFinishJob = nullptr; // Guarded by mUpdateMutex
+
+  // Continuation handling
+  struct Continuation
+  {
+    void* task = nullptr;
+    void(*fnArm)(void*, AsyncTaskLaunchOptions const&) = nullptr; // @MainThread
+    void(*fnStart)(void*, Result const&) = nullptr; // @WorkerThread
+    void(*fnAbort)(void*, std::exception_ptr) noexcept = nullptr; // @WorkerThread or @MainThread
+  };
+  std::optional<Continuation> mContinuation{}; // Set by the main thread before execute(), taken by the worker
+  bool isChained = false; // Started by the previous task
+
+  // Result cache handling, it is available for copyable Result and equality comparable Params
+  static bool constexpr isResultCacheSupported = std::is_copy_constructible_v<Result> && (AsyncTaskIsEqualityComparable<Params>::value && ...);
+  AsyncTaskResultCacheBase<Result, Params...>* mResultCache = nullptr;
+  bool isResultCacheLeading = false; // The computation is expected by the cache, set before the job is submitted
+  std::atomic_bool isResultCacheWaiting = { false }; // Waiter of the cache, it is cleared at the resume or at the cancellation
+
+public:
+  AsyncTaskBase() noexcept : AsyncTaskBase(AsyncTaskThreadExecutor::getDefault()) {}
+  explicit AsyncTaskBase(AsyncTaskExecutor& executor) noexcept : AsyncTaskBase(executor, *std::pmr::get_default_resource()) {}
+  explicit AsyncTaskBase(std::pmr::memory_resource& memoryResource) noexcept : AsyncTaskBase(AsyncTaskThreadExecutor::getDefault(), memoryResource) {}
+  AsyncTaskBase(AsyncTaskExecutor& executor, std::pmr::memory_resource& memoryResource) noexcept : mExecutor(&executor), mMemoryResource(&memoryResource) {}
+
+protected:
+  AsyncTaskBase(AsyncTaskBase const&) = delete;
+  AsyncTaskBase(AsyncTaskBase&&) = delete;
+  AsyncTaskBase& operator=(AsyncTaskBase const&) = delete;
+  AsyncTaskBase& operator=(AsyncTaskBase&&) = delete;
+  virtual ~AsyncTaskBase() noexcept
+  {
+    cancelAndWait();
+  };
+
+  // Cancel the running doInBackground() and wait for its finish without the callbacks.
+  // Derived class should invoke it in its Dtor, if its members are used by the worker (e.g.: AsyncTaskCo's coroutine).
+  // @MainThread
+  void cancelAndWait() noexcept
+  {
+    auto const status = getStatus();
+    if (status == Status::RUNNING)
+    {
+      if (!this->isCancelled())
+        this->cancel();
+
+      if (this->mFuture.valid())
+        this->mFuture.wait();
+      // Exception rethrow: No. It could terminate the program if others already threw.
+    }
+
+    // The worker notifies about the finish after the result is set, it should be waited.
+    std::unique_lock<std::mutex> lock(this->mUpdateMutex);
+  }
+
+public:
+
+  // Initiate the asynchronous task
+  // If the task is already began, AsyncTaskIllegalStateException will be thrown
+  // @MainThread
+  AsyncTaskBase<Progress, Result, Params...>& execute(Params const&... params) noexcept(false)
+  {
+    return execute(AsyncTaskLaunchOptions{}, params...);
+  }
+
+  // Initiate the asynchronous task with scheduling attributes: priority on the executor, deadline of the start, and launch policy (see AsyncTaskLaunchPolicy)
+  // If the task is already began, AsyncTaskIllegalStateException will be thrown
+  // @MainThread
+  AsyncTaskBase<Progress, Result, Params...>& execute(AsyncTaskLaunchOptions const& options, Params const&... params) noexcept(false)
+  {
+    checkPending();
+    if (this->isChained)
+      throw AsyncTaskIllegalStateException(AsyncTaskIllegalStateException::eEx::TaskIsAlreadyChained);
+
+    this->mStatus = Status::RUNNING;
+    this->mLaunchOptions = options;
+    if (options.policy == AsyncTaskLaunchPolicy::Speculative)
+      this->mLaunchOptions.priority = AsyncTaskPriority::Background;
+
+    if (this->mStats)
+      recordTime(this->mStats->tExecute);
+
+    this->onPreExecute();
+    this->storeParams(params...);
+    this->armResult();
+    if (options.policy == AsyncTaskLaunchPolicy::Deferred)
+      this->isLaunchDeferred.store(true);
+    else
+      this->launchJob();
+
+    return *this;
+  }
+
+  // Launch the Deferred task now, it is no-op for the others or for the already launched one
+  // @MainThread
+  void launch() noexcept(false)
+  {
+    if (this->isLaunchDeferred.exchange(false))
+      this->launchJob();
+  }
+
+  // Set the worker placement hint of the execute()s, which do not give it in their AsyncTaskLaunchOptions (see AsyncTaskAffinity)
+  // @MainThread, before execute()
+  void setAffinity(AsyncTaskAffinity affinity) noexcept(false)
+  {
+    checkPending();
+    this->mAffinity = std::move(affinity);
+  }
+
+  // Share the Results of the same Params through the cache (see AsyncTaskResultCache of the asynctask_cache.h), nullptr disables it.
+  // The task's execute() could be completed without doInBackground(), or it could wait for another task's computation. Its onPreExecute() and onPostExecute() are invoked in every case.
+  // @MainThread, before execute()
+  template<bool isSupported = isResultCacheSupported> // Not instantiated by the explicit instantiation of the task
+  void setResultCache(AsyncTaskResultCacheBase<Result, Params...>* resultCache) noexcept(false)
+  {
+    static_assert(isSupported, "Result cache needs copy constructible Result and equality comparable Params.");
+    checkPending();
+    this->mResultCache = resultCache;
+  }
+
+  // Broadcast every stored progress to the subscribers of the broadcast (see AsyncTaskProgressBroadcast), nullptr disables it. onProgressUpdate() is invoked as before.
+  // Many tasks could publish into the same broadcast.
+  // @MainThread, before execute()
+  template<bool isSupported = std::is_copy_constructible_v<Progress>> // Not instantiated by the explicit instantiation of the task
+  void setProgressBroadcast(AsyncTaskProgressBroadcast<Progress>* progressBroadcast) noexcept(false)
+  {
+    static_assert(isSupported, "Progress broadcast needs copy constructible Progress.");
+    checkPending();
+    this->mProgressBroadcast = progressBroadcast;
+  }
+
+  // Re-arm the pending or finished task to execute it again in place: the task object, its progress storage and its params' storage are reused.
+  // Cancellation, exception and unhandled progress of the earlier run are dropped, the result is kept until the next finish.
+  // A finished task's chain (then()) should be built again, a pending task's chain is kept.
+  // If the task is running, AsyncTaskIllegalStateException will be thrown
+  // @MainThread
+  void reset() noexcept(false)
+  {
+    if (mStatus == Status::RUNNING && mFuture.valid()) // Invalid future: execute() is failed to submit the job
+      throw AsyncTaskIllegalStateException(AsyncTaskIllegalStateException::eEx::TaskIsAlreadyRunning);
+
+    if (mStatus == Status::FINISHED)
+    {
+      this->mContinuation.reset();
+      this->isChained = false;
+    }
+
+    this->mStatus = Status::PENDING;
+    this->isLaunchDeferred.store(false);
+    this->mPromise.reset();
+    this->mFuture = {};
+    this->mCancellation.reset();
+    this->isExceptionRethrowNeededOnMainThread.store(false);
+    this->eptr = nullptr;
+    this->mUpdateCountHandled = this->mUpdateCount.load();
+    this->isWakeUpSignaled.store(false);
+    this->isThrottleStored = false;
+    this->isProgressThrottled = false;
+    this->isProgressHeldBack = false;
+    if (this->mStats)
+      this->mStats.emplace();
+
+    this->resetProgress();
+  }
+
+  // Chain the next task, which is executed with this task's Result as soon as it is returned by the postResult(), on the worker thread without main thread round trip.
+  // The Result is copied into the next task, this task's get() still returns it.
+  // If this task is cancelled or its doInBackground() throws, the next task is finished as cancelled without doInBackground() (and its get()/onCallbackLoop() rethrows the exception).
+  // Both tasks should be PENDING, the next one is managed as RUNNING from this task's execute() (its onPreExecute() is invoked there), but it must not be executed separately.
+  // Return the next task to continue the chain.
+  // @MainThread
+  template<typename ProgressNext, typename ResultNext>
+  AsyncTaskBase<ProgressNext, ResultNext, Result>& then(AsyncTaskBase<ProgressNext, ResultNext, Result>& next) noexcept(false)
+  {
+    using Next = AsyncTaskBase<ProgressNext, ResultNext, Result>;
+
+    checkPending();
+    next.checkPending();
+    if (this->mContinuation || next.isChained || static_cast<void*>(&next) == static_cast<void*>(this))
+      throw AsyncTaskIllegalStateException(AsyncTaskIllegalStateException::eEx::TaskIsAlreadyChained);
+
+    next.isChained = true;
+    this->mContinuation = Continuation{ &next
+      , [](void* task, AsyncTaskLaunchOptions const& options) { static_cast<Next*>(task)->arm(options); }
+      , [](void* task, Result const& result) { static_cast<Next*>(task)->startChained(result); }
+      , [](void* task, std::exception_ptr eptrPrevious) noexcept { static_cast<Next*>(task)->abortChained(std::move(eptrPrevious)); }
+    };
+    return next;
+  }
+
+  // @MainThread
+  Status getStatus() const noexcept { return mStatus; }
+
+  // @MainThread and @Workerthread
+  AsyncTaskExecutor& getExecutor() const noexcept { return *mExecutor; }
+
+  // Internal allocations (future shared state, progress queue) are served by this memory resource, it must be thread-safe (e.g.: std::pmr::synchronized_pool_resource).
+  // Params are stored inside the task object without allocation.
+  // @MainThread and @Workerthread
+  std::pmr::memory_resource& getMemoryResource() const noexcept { return *mMemoryResource; }
+
+#ifndef ASYNCTASK_NO_STATS
+  // Collect the timing and the counters of the runs (see AsyncTaskStats), the optional trace sink receives them at every finish.
+  // Hooks of the disabled stats cost a branch, the counters' storage is kept in the task (see ASYNCTASK_NO_STATS).
+  // @MainThread, before execute()
+  void enableStats(AsyncTaskTraceSink* traceSink = nullptr)
+  {
+    this->mStats.emplace();
+    this->mTraceSink = traceSink;
+  }
+#endif
+
+  // Stats of the current or the last run, std::nullopt if it is not enabled. The worker's timestamps are complete after the finish.
+  // @MainThread
+  std::optional<AsyncTaskStats> getStats() const noexcept
+  {
+    if (!this->mStats)
+      return std::nullopt;
+
+    auto const fnTime = [](std::atomic<AsyncTaskStats::Clock::rep> const& t) { return AsyncTaskStats::Clock::time_point(AsyncTaskStats::Clock::duration(t.load(std::memory_order_relaxed))); };
+    auto const fnCount = [](std::atomic<uint64_t> const& n) { return n.load(std::memory_order_relaxed); };
+
+    auto stats = AsyncTaskStats{};
+    stats.tExecute = fnTime(this->mStats->tExecute);
+    stats.tStart = fnTime(this->mStats->tStart);
+    stats.tFinish = fnTime(this->mStats->tFinish);
+    stats.tDispatch = fnTime(this->mStats->tDispatch);
+    stats.nPublished = fnCount(this->mStats->nPublished);
+    stats.nThrottled = fnCount(this->mStats->nThrottled);
+    stats.nStored = fnCount(this->mStats->nStored);
+    stats.nCoalesced = fnCount(this->mStats->nCoalesced);
+    stats.nDropped = fnCount(this->mStats->nDropped);
+    stats.nQueueHighWater = fnCount(this->mStats->nQueueHighWater);
+    return stats;
+  }
+
+private:
+  // @MainThread
+  void checkPending() const noexcept(false)
+  {
+    switch (mStatus)
+    {
+      case Status::PENDING: break; // Everything is ok.
+      case Status::RUNNING: throw AsyncTaskIllegalStateException(AsyncTaskIllegalStateException::eEx::TaskIsAlreadyRunning);
+      case Status::FINISHED: throw AsyncTaskIllegalStateException(AsyncTaskIllegalStateException::eEx::TaskIsAlreadyFinished);
+    }
+  }
+
+  // Params of the earlier run are assigned if it is possible, to reuse their capacity
+  void storeParams(Params const&... params) noexcept(false)
+  {
+    if constexpr (std::is_copy_assignable_v<std::tuple<Params...>>)
+    {
+      if (this->mParams)
+      {
+        *this->mParams = std::forward_as_tuple(params...);
+        return;
+      }
+    }
+
+    this->mParams.emplace(params...);
+  }
+
+  // Prepare the result channel, and the chained tasks recursively
+  // @MainThread
+  void armResult() noexcept(false)
+  {
+    this->mPromise.emplace(std::allocator_arg, std::pmr::polymorphic_allocator<Result>(this->mMemoryResource));
+    this->mFuture = this->mPromise->get_future();
+    this->isBackgroundStarted = false;
+    if (!this->mContinuation)
+      return;
+
+    try
+    {
+      this->mContinuation->fnArm(this->mContinuation->task, this->mLaunchOptions);
+    }
+    catch (...)
+    {
+      this->mFuture = {}; // Job will not be submitted, Dtor should not wait for it.
+      throw;
+    }
+  }
+
+  // Submit the job by the launch policy, the result cache could make it needless
+  // @MainThread
+  void launchJob() noexcept(false)
+  {
+    try
+    {
+      if (this->mLaunchOptions.policy == AsyncTaskLaunchPolicy::Speculative && !this->mExecutor->hasIdleWorkers())
+        return this->abortChained(nullptr); // Finished as cancelled
+
+      if constexpr (isResultCacheSupported)
+      {
+        if (this->mResultCache && this->acquireResultCache())
+          return;
+      }
+
+      if (this->mLaunchOptions.policy == AsyncTaskLaunchPolicy::Inline)
+      {
+        this->detachProgress(); // Nobody could consume the progress during the run
+        return this->runInBackground();
+      }
+
+      this->mExecutor->submit(this->mJob);
+    }
+    catch (...)
+    {
+      this->releaseResultCache(nullptr);
+      this->mFuture = {}; // Job is not submitted, Dtor should not wait for it.
+      this->abortContinuation(std::current_exception());
+      throw;
+    }
+  }
+
+  // Return true if the job should not be submitted: the Result is copied from the cache, or it is waited for
+  // @MainThread
+  bool acquireResultCache() noexcept(false)
+  {
+    if constexpr (isResultCacheSupported)
+    {
+      using Cache = AsyncTaskResultCacheBase<Result, Params...>;
+
+      auto resultHit = std::optional<Result>{};
+      this->isResultCacheWaiting.store(true); // Before the registration: the resume could be invoked right after it
+      auto const acquisition = this->mResultCache->acquire(*this->mParams, typename Cache::Waiter{ this, &resumeFromResultCache }, resultHit);
+      if (acquisition != Cache::Acquisition::Wait)
+        this->isResultCacheWaiting.store(false);
+
+      switch (acquisition)
+      {
+        case Cache::Acquisition::Hit: this->completeWith(*resultHit); return true;
+        case Cache::Acquisition::Wait: return true;
+        case Cache::Acquisition::Lead: this->isResultCacheLeading = true; return false;
+      }
+    }
+    return false;
+  }
+
+  // The computation of the Params is finished, the waiters are resumed
+  // @WorkerThread
+  void releaseResultCache(Result const* result) noexcept
+  {
+    if constexpr (isResultCacheSupported)
+    {
+      if (!std::exchange(this->isResultCacheLeading, false))
+        return;
+
+      if (result && !this->isCancelled())
+        this->mResultCache->complete(*this->mParams, *result);
+      else
+        this->mResultCache->abandon(*this->mParams);
+    }
+  }
+
+  // Resume of a waiter: it is completed by the Result, or it takes over the computation if the result is nullptr
+  // @WorkerThread of the computing task
+  static void resumeFromResultCache(void* task, Result const* result) noexcept
+  {
+    auto const self = static_cast<AsyncTaskBase*>(task);
+    self->isResultCacheWaiting.store(false);
+    if (result)
+      return self->completeWith(*result);
+
+    self->isResultCacheLeading = true;
+    try
+    {
+      self->mExecutor->submit(self->mJob);
+    }
+    catch (...)
+    {
+      self->releaseResultCache(nullptr);
+      self->abortChained(std::current_exception());
+    }
+  }
+
+  // Finish the task by the given Result without doInBackground(), e.g.: from the result cache
+  // @MainThread or @WorkerThread of the computing task
+  void completeWith(Result const& result) noexcept
+  {
+    if constexpr (isResultCacheSupported)
+    {
+      this->continueWith(result);
+
+      auto promise = std::move(*this->mPromise);
+      if (this->mStats)
+      {
+        recordTime(this->mStats->tStart);
+        recordTime(this->mStats->tFinish);
+      }
+
+      std::unique_lock<std::mutex> lock(this->mUpdateMutex);
+      try
+      {
+        promise.set_value(result);
+      }
+      catch (...)
+      {
+        promise.set_exception(std::current_exception());
+      }
+      notifyUpdateLocked();
+      releaseLocked(std::move(promise));
+      submitFinishJobLocked(lock);
+    }
+  }
+
+  // Chained task's execute() without params and submit, those are given by the previous task's worker.
+  // Priority is inherited from the previous task, the deadline is not: the chained task starts right after the previous one.
+  // @MainThread
+  void arm(AsyncTaskLaunchOptions const& options) noexcept(false)
+  {
+    checkPending();
+    this->mStatus = Status::RUNNING;
+    this->mLaunchOptions = AsyncTaskLaunchOptions{ options.priority, std::nullopt };
+
+    this->onPreExecute();
+    this->armResult();
+  }
+
+  // @WorkerThread of the previous task
+  void startChained(Params const&... params) noexcept(false)
+  {
+    if (this->mStats)
+      recordTime(this->mStats->tExecute);
+
+    this->storeParams(params...);
+    this->mExecutor->submit(this->mJob);
+  }
+
+  // Finish the chained task as cancelled without doInBackground(), the previous task's exception is inherited. Cancelled or failed waiters of the result cache are finished by it too.
+  // @WorkerThread of the previous task, or @MainThread if the previous task could not be submitted
+  void abortChained(std::exception_ptr eptrPrevious) noexcept
+  {
+    this->mCancellation.cancel();
+    if (eptrPrevious)
+    {
+      this->eptr = eptrPrevious;
+      this->isExceptionRethrowNeededOnMainThread.store(true);
+    }
+
+    this->abortContinuation(std::move(eptrPrevious));
+
+    auto promise = std::move(*this->mPromise);
+    if (this->mStats)
+      recordTime(this->mStats->tFinish);
+
+    std::unique_lock<std::mutex> lock(this->mUpdateMutex);
+    try
+    {
+      promise.set_value(Result{});
+    }
+    catch (...)
+    {
+      promise.set_exception(std::current_exception());
+    }
+    notifyUpdateLocked();
+    releaseLocked(std::move(promise));
+    submitFinishJobLocked(lock);
+  }
+
+  // @WorkerThread or @MainThread
+  void abortContinuation(std::exception_ptr eptrPrevious) noexcept
+  {
+    if (!this->mContinuation)
+      return;
+
+    auto const continuation = *this->mContinuation;
+    this->mContinuation.reset();
+    continuation.fnAbort(continuation.task, std::move(eptrPrevious));
+  }
+
+  // Hand over the result to the chained task, before this task's finish is signaled
+  // @WorkerThread
+  void continueWith(Result const& result) noexcept
+  {
+    if (!this->mContinuation)
+      return;
+
+    if (isCancelled())
+      return this->abortContinuation(this->isExceptionRethrowNeededOnMainThread.load() ? this->eptr : nullptr);
+
+    auto const continuation = *this->mContinuation;
+    this->mContinuation.reset();
+    try
+    {
+      continuation.fnStart(continuation.task, result);
+    }
+    catch (...)
+    {
+      continuation.fnAbort(continuation.task, std::current_exception());
+    }
+  }
+
+  // @WorkerThread
+  Result process(Params const&... params)
+  {
+    if (isCancelled())
+      return {}; // Protect against undefined behavior, if Dtor is invoked before the - pure virtual function represented - task would be started
+
+    try
+    {
+      auto result = this->doInBackground(params...);
+      if (isCancelled())
+        return {};
+
+      this->publishThrottledProgress();
+      this->flushProgress();
+
+      return this->postResult(std::move(result));
+    }
+    catch (...)
+    {
+      cancel();
+      isExceptionRethrowNeededOnMainThread.store(true);
+      eptr = std::current_exception();
+    }
+    return {};
+  }
+
+  // @WorkerThread
+  void runInBackground() noexcept
+  {
+    // Stepwise doInBackground() is started at its first step, the worker re-enters here at the next ones
+    if (!std::exchange(this->isBackgroundStarted, true))
+    {
+      if (this->mStats)
+        recordTime(this->mStats->tStart);
+
+      // Missed deadline: process() returns before the doInBackground() because of the cancellation
+      if (this->mLaunchOptions.deadline && !this->isCancelled() && std::chrono::steady_clock::now() > *this->mLaunchOptions.deadline)
+        this->cancel();
+    }
+
+    this->cancelIfPreempted();
+
+    // Stepwise doInBackground() gives the worker to the other pending jobs between its steps
+    while (this->isStepwise && !this->isCancelled() && !std::apply([this](Params const&... params) { return this->stepInBackground(params...); }, *this->mParams))
+    {
+      if (!this->mExecutor->hasPendingJobs())
+        continue;
+
+      try
+      {
+        this->mExecutor->submit(this->mJob);
+        return;
+      }
+      catch (...)
+      {
+        // Resubmission is failed, the next step is run on this worker.
+      }
+    }
+
+    // The promise is moved to the worker's stack: after the value is set, only the locked mUpdateMutex keeps this object alive.
+    auto promise = std::move(*this->mPromise);
+    try
+    {
+      auto result = std::apply([this](Params const&... params) { return this->process(params...); }, *this->mParams);
+      this->releaseResultCache(&result);
+      this->continueWith(result);
+      if (this->mStats)
+        recordTime(this->mStats->tFinish);
+
+      std::unique_lock<std::mutex> lock(this->mUpdateMutex);
+      promise.set_value(std::move(result));
+      notifyUpdateLocked();
+      releaseLocked(std::move(promise));
+      submitFinishJobLocked(lock);
+    }
+    catch (...)
+    {
+      this->releaseResultCache(nullptr); // No-op if it is already released
+      this->abortContinuation(std::current_exception()); // No-op if it is already handed over
+      if (this->mStats)
+        recordTime(this->mStats->tFinish);
+
+      std::unique_lock<std::mutex> lock(this->mUpdateMutex);
+      promise.set_exception(std::current_exception()); // Result's copy or move constructor threw outside of the doInBackground()
+      notifyUpdateLocked();
+      releaseLocked(std::move(promise));
+      submitFinishJobLocked(lock);
+    }
+  }
+
+  // The promise's reference to the shared state is released while the task (and its memory resource) is surely alive
+  // @WorkerThread
+  static void releaseLocked(std::promise<Result>&& promise) noexcept
+  {
+    auto const promiseReleased = std::move(promise);
+  }
+
+  // The finish job is submitted to the executor, or it is run after the lock is released if the submission is failed. This object must not be used after that.
+  // @WorkerThread
+  void submitFinishJobLocked(std::unique_lock<std::mutex>& lock) noexcept
+  {
+    auto const job = std::exchange(this->mFinishJob, nullptr);
+    if (!job)
+      return;
+
+    try
+    {
+      this->mExecutor->submit(*job);
+    }
+    catch (...)
+    {
+      lock.unlock();
+      job->run();
+    }
+  }
+
+  // @WorkerThread or @MainThread
+  void notifyUpdate() noexcept
+  {
+    this->mUpdateCount.fetch_add(1);
+    if (this->mUpdateWaiterCount.load() > 0)
+    {
+      {
+        std::unique_lock<std::mutex> lock(this->mUpdateMutex);
+      }
+      this->mUpdateCondition.notify_all();
+    }
+
+    wakeUp();
+  }
+
+  // @WorkerThread
+  void notifyUpdateLocked() noexcept
+  {
+    this->mUpdateCount.fetch_add(1);
+    this->mUpdateCondition.notify_all();
+    wakeUp();
+  }
+
+  void wakeUp() noexcept
+  {
+    if (this->fnWakeUp && !this->isWakeUpSignaled.exchange(true))
+      this->fnWakeUp();
+  }
+
+  static void recordTime(std::atomic<AsyncTaskStats::Clock::rep>& t) noexcept
+  {
+    t.store(AsyncTaskStats::Clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+  }
+
+public:
+
+protected:
+
+  // Background worker task
+  // Exception can be thrown, it will be rethrown in get(), onCallbackLoop() or Dtor()
+  // @WorkerThread
+  virtual Result doInBackground(Params const&... params) = 0;
+
+  // Stepwise background work before the doInBackground() (e.g.: AsyncTaskCo's coroutine), return true if the doInBackground() can be invoked.
+  // Between the steps, the job is resubmitted to the executor if it has other pending jobs. It is not invoked after cancellation.
+  // It is invoked only if isStepwise is set, the other tasks go straight to the doInBackground() without this virtual call.
+  // @WorkerThread
+  virtual bool stepInBackground(Params const&...) noexcept { return true; }
+
+  // Opt-in of the stepInBackground(), it should be set by the derived class' Ctor.
+  bool isStepwise = false;
+
+  // Define the store mechanism of the current state of the progress inside the class
+  // @WorkerThread
+  virtual void storeProgress(Progress const&) {}
+
+  // Store the progress which is kept back by the store mechanism, invoked after the doInBackground() if it is not cancelled
+  // @WorkerThread
+  virtual void flushProgress() {}
+
+  // Feedback system will not handle more progress, because the main thread is blocked by the get()
+  // @MainThread
+  virtual void detachProgress() {}
+
+  // Drop the unhandled progress before the re-run, the storage is kept for reuse (see reset())
+  // @MainThread
+  virtual void resetProgress() {}
+
+public:
+  // Store the current state of the progress inside the class
+  // Use inside the doInBackground()
+  // @WorkerThread
+  void publishProgress(Progress const& progress)
+  {
+    this->publishProgressBy(progress, [this](Progress const& progressStored) { this->storeProgress(progressStored); });
+  }
+
+  // Store the current state of the progress inside the class without copy, if the store mechanism supports it (see getMovableProgress())
+  // Use inside the doInBackground()
+  // @WorkerThread
+  void publishProgress(Progress&& progress)
+  {
+    this->publishProgressBy(std::move(progress), [this](Progress& progressStored) { this->storeMovableProgress(progressStored); });
+  }
+
+  // Set the throttle of the publishProgress() (see AsyncTaskProgressThrottle), a default constructed one disables it.
+  // @MainThread, before execute()
+  void setProgressThrottle(AsyncTaskProgressThrottle<Progress> const& throttle) noexcept
+  {
+    this->mThrottle = throttle;
+    if constexpr (std::is_arithmetic_v<Progress>)
+    {
+      if (!this->mThrottle.fnMeasure)
+        this->mThrottle.fnMeasure = [](Progress const& progress) { return static_cast<double>(progress); };
+    }
+
+    this->isThrottleEnabled = this->mThrottle.minInterval > std::chrono::steady_clock::duration::zero() || (this->mThrottle.minDelta > 0.0 && this->mThrottle.fnMeasure);
+    this->isThrottleStored = false;
+  }
+
+protected:
+  // publishProgress() by the given store function instead of the virtual storeProgress(), e.g.: AsyncTaskStatic resolves it at compile time
+  // @WorkerThread
+  template<typename Store>
+  void publishProgressBy(Progress const& progress, Store&& fnStore)
+  {
+    // doInBackground() could invoke publishProgress() during dtor(), so publishProgress() must be a non-virtual function and prevent to call virtual ones using isCancelled()
+    if (isCancelled())
+      return;
+
+    if (this->mStats)
+      this->mStats->nPublished.fetch_add(1, std::memory_order_relaxed);
+
+    this->cancelIfPreempted();
+    if (this->isDroppedByThrottle(progress))
+      return this->keepThrottledProgress(progress);
+
+    this->broadcastProgress(progress);
+    fnStore(progress);
+    this->recordStored();
+    this->notifyStored();
+  }
+
+  // fnStore(Progress&) could move from the progress
+  // @WorkerThread
+  template<typename Store>
+  void publishProgressBy(Progress&& progress, Store&& fnStore)
+  {
+    if (isCancelled())
+      return;
+
+    if (this->mStats)
+      this->mStats->nPublished.fetch_add(1, std::memory_order_relaxed);
+
+    this->cancelIfPreempted();
+    if (this->isDroppedByThrottle(progress))
+      return this->keepThrottledProgress(std::move(progress));
+
+    this->broadcastProgress(progress); // Before the store could move from it
+    fnStore(progress);
+    this->recordStored();
+    this->notifyStored();
+  }
+
+  // Notify the main thread about a new partial result (see AsyncTaskStreaming)
+  // @WorkerThread
+  void notifyPartialResult() noexcept { notifyUpdate(); }
+
+  // The store mechanism keeps the progress on the worker (e.g.: AsyncTaskPQ's reduction), there is nothing new for the main thread
+  // @WorkerThread
+  void holdBackStoredProgress() noexcept { this->isProgressHeldBack = true; }
+
+  // Stats of the progress queue's store()
+  // @WorkerThread
+  void recordProgressStore(AsyncTaskProgressStoreResult const& result) noexcept
+  {
+    if (!this->mStats)
+      return;
+
+    if (result.isCoalesced)
+      this->mStats->nCoalesced.fetch_add(1, std::memory_order_relaxed);
+
+    if (result.nDropped > 0)
+      this->mStats->nDropped.fetch_add(result.nDropped, std::memory_order_relaxed);
+
+    auto nHighWater = this->mStats->nQueueHighWater.load(std::memory_order_relaxed);
+    while (nHighWater < result.nQueued && !this->mStats->nQueueHighWater.compare_exchange_weak(nHighWater, result.nQueued, std::memory_order_relaxed))
+      ;
+  }
+
+private:
+  // @WorkerThread
+  void storeMovableProgress(Progress& progress)
+  {
+    auto& movableProgress = getMovableProgressOfThread();
+    movableProgress = &progress;
+    try
+    {
+      this->storeProgress(progress);
+    }
+    catch (...)
+    {
+      movableProgress = nullptr;
+      throw;
+    }
+    movableProgress = nullptr;
+  }
+
+  // Return true if the progress should not be stored, otherwise it is registered as the last stored one.
+  // @WorkerThread
+  bool isDroppedByThrottle(Progress const& progress) noexcept
+  {
+    if (!this->isThrottleEnabled)
+      return false;
+
+    auto const isTimeFiltered = this->mThrottle.minInterval > std::chrono::steady_clock::duration::zero();
+    auto const isDeltaFiltered = this->mThrottle.minDelta > 0.0 && this->mThrottle.fnMeasure;
+    auto const now = isTimeFiltered ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+    auto const measure = isDeltaFiltered ? this->mThrottle.fnMeasure(progress) : 0.0;
+    if (this->isThrottleStored)
+    {
+      if (isTimeFiltered && now - this->mThrottleStoredAt < this->mThrottle.minInterval)
+        return true;
+
+      auto const delta = measure > this->mThrottleStoredMeasure ? measure - this->mThrottleStoredMeasure : this->mThrottleStoredMeasure - measure;
+      if (isDeltaFiltered && delta < this->mThrottle.minDelta)
+        return true;
+    }
+
+    this->isThrottleStored = true;
+    this->isProgressThrottled = false;
+    this->mThrottleStoredAt = now;
+    this->mThrottleStoredMeasure = measure;
+    return false;
+  }
+
+  // Assign the dropped progress to reuse the capacity of the earlier one, if it is possible
+  // @WorkerThread
+  template<typename ProgressT>
+  void keepThrottledProgress(ProgressT&& progress)
+  {
+    if constexpr (std::is_assignable_v<Progress&, ProgressT&&>)
+    {
+      if (this->mProgressThrottled)
+        *this->mProgressThrottled = std::forward<ProgressT>(progress);
+      else
+        this->mProgressThrottled.emplace(std::forward<ProgressT>(progress));
+    }
+    else
+      this->mProgressThrottled.emplace(std::forward<ProgressT>(progress));
+
+    this->isProgressThrottled = true;
+    if (this->mStats)
+      this->mStats->nThrottled.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // @WorkerThread
+  void broadcastProgress(Progress const& progress)
+  {
+    if constexpr (std::is_copy_constructible_v<Progress>)
+    {
+      if (this->mProgressBroadcast)
+        this->mProgressBroadcast->publish(progress);
+    }
+  }
+
+  // @WorkerThread
+  void recordStored() noexcept
+  {
+    if (this->mStats)
+      this->mStats->nStored.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // The latest dropped progress is stored after the doInBackground()
+  // @WorkerThread
+  void publishThrottledProgress()
+  {
+    if (!this->isProgressThrottled)
+      return;
+
+    this->isProgressThrottled = false;
+    this->broadcastProgress(*this->mProgressThrottled);
+    this->storeMovableProgress(*this->mProgressThrottled);
+    this->recordStored();
+    this->notifyStored();
+  }
+
+  // Speculative task gives up its worker if other jobs are waiting for one
+  // @WorkerThread
+  void cancelIfPreempted() noexcept
+  {
+    if (this->mLaunchOptions.policy == AsyncTaskLaunchPolicy::Speculative && !this->isCancelled() && this->mExecutor->hasPendingJobs())
+      this->cancel();
+  }
+
+  // @WorkerThread
+  void notifyStored() noexcept
+  {
+    if (!std::exchange(this->isProgressHeldBack, false))
+      notifyUpdate();
+  }
+
+public:
+  // Run body(i) for every i in [begin, end) in parallel: helper jobs are submitted to the executor's getParallelExecutor(), the calling worker processes chunks (of grainSize indices) too.
+  // On the default AsyncTaskThreadExecutor, the helpers run on the shared AsyncTaskThreadPool::getDefault(), no thread is started for them.
+  // fnReport(nDone, nTotal) is invoked on the calling worker when more indices are processed, e.g.: to publishProgress() from one thread.
+  // Chunks are stopped promptly at the cancellation. Exception of the body is rethrown after the running chunks are finished.
+  // Return true if every index is processed.
+  // Use inside the doInBackground(), the body must be thread-safe.
+  // @WorkerThread
+  template<typename Body, typename Report>
+  bool parallelFor(size_t begin, size_t end, size_t grainSize, Body&& body, Report&& fnReport)
+  {
+    if (begin >= end)
+      return !isCancelled();
+
+    grainSize = std::max<size_t>(1, grainSize);
+    auto const nTotal = end - begin;
+    auto const nChunk = (nTotal - 1) / grainSize + 1;
+    auto& executor = this->mExecutor->getParallelExecutor();
+    auto const nHelper = std::min(nChunk, std::max<size_t>(1, executor.getConcurrency())) - 1;
+
+    using BodyT = std::remove_reference_t<Body>;
+    auto const loop = std::allocate_shared<AsyncTaskParallelFor>(std::pmr::polymorphic_allocator<AsyncTaskParallelFor>(this->mMemoryResource)
+      , begin, end, grainSize, nHelper, this->getCancellationToken(), this->mLaunchOptions.priority
+      , const_cast<void*>(static_cast<void const*>(std::addressof(body)))
+      , [](void* body, size_t i) { (*static_cast<BodyT*>(body))(i); }
+      , *this->mMemoryResource);
+
+    AsyncTaskParallelFor::start(loop, executor);
+    return loop->run([&](size_t nDone) { fnReport(nDone, nTotal); });
+  }
+
+  // parallelFor() without progress report
+  // @WorkerThread
+  template<typename Body>
+  bool parallelFor(size_t begin, size_t end, size_t grainSize, Body&& body)
+  {
+    return parallelFor(begin, end, grainSize, std::forward<Body>(body), [](size_t, size_t) {});
+  }
+
+protected:
+  // Returns the modifiable instance of the progress if it was published as rvalue by the current thread, the store mechanism could move from it.
+  // An overridden storeProgress() still gets every progress as const&, it should not use it after it is passed to the base class storeProgress().
+  // @WorkerThread
+  static Progress* getMovableProgress(Progress const& progress) noexcept
+  {
+    auto const movableProgress = getMovableProgressOfThread();
+    return movableProgress == &progress ? movableProgress : nullptr;
+  }
+
+private:
+  static Progress*& getMovableProgressOfThread() noexcept
+  {
+    static thread_local Progress* movableProgress = nullptr;
+    return movableProgress;
+  }
+
+public:
+  // Post process result if it is needed, still on the worker thread
+  // @WorkerThread
+  virtual Result postResult(Result&& result) { return std::move(result); }
+
+  // Usually to setup the feedback system
+  // @MainThread
+  virtual void onPreExecute() {}
+
+  // Usually to declare the finishing in the feedback system
+  // @MainThread
+  virtual void onPostExecute(Result const&) {}
+
+  // Cleanup function if the task is canceled
+  // @MainThread
+  virtual void onCancelled() {}
+
+  // Cleanup function if the task is canceled
+  // @MainThread
+  virtual void onCancelled(Result const&) { onCancelled(); }
+
+protected:
+  virtual void handleProgress() = 0;
+
+  // Handle at most nItemBudget progress items, the budget is decreased by the handled ones. The others are kept for the next call.
+  // @MainThread
+  virtual void handleProgressWithin(size_t& nItemBudget)
+  {
+    if (nItemBudget == 0)
+      return;
+
+    handleProgress();
+    --nItemBudget;
+  }
+
+  // Number of the progress items which are waiting for the handling
+  // @MainThread
+  virtual size_t getPendingProgressCount() const { return 0; }
+
+  // Handle at most nMax partial results (see AsyncTaskStreaming), return the number of the handled ones. They are handled before the progress and the onPostExecute().
+  // @MainThread
+  virtual size_t handlePartialResults(size_t /*nMax*/) { return 0; }
+
+  // Number of the partial results which are waiting for the handling
+  // @MainThread
+  virtual size_t getPendingPartialResultCount() const { return 0; }
+
+public:
+  // Returns true if the task is canceled by the cancel()
+  // It is usable to break process inside the doInBackground()
+  // @MainThread and @Workerthread
+  bool isCancelled() const noexcept { return mCancellation.isCancelled(); }
+
+  // Token of the task's cancellation: doInBackground() could wait on it instead of sleeping (waitFor()), or it could register AsyncTaskCancelCallback to interrupt its blocking calls.
+  // @MainThread and @Workerthread
+  AsyncTaskCancellationToken getCancellationToken() noexcept { return AsyncTaskCancellationToken(mCancellation); }
+
+  // Cancel the task, the waits on the cancellation token are woken up and the registered AsyncTaskCancelCallbacks are invoked on this thread.
+  // @MainThread
+  void cancel() noexcept
+  {
+    mCancellation.cancel();
+    if (this->isLaunchDeferred.exchange(false))
+      this->abortChained(nullptr);
+
+    if constexpr (isResultCacheSupported)
+    {
+      if (this->isResultCacheWaiting.exchange(false) && this->mResultCache->detach(*this->mParams, this))
+        this->abortChained(nullptr);
+    }
+
+    notifyUpdate();
+  }
+
+  // Submit the job to the executor when the task is finished (e.g.: to resume an awaiting coroutine), only one job can be registered.
+  // Return false if the task is already finished, the job is not submitted in this case.
+  // @MainThread
+  bool submitOnFinish(AsyncTaskJob& job) noexcept
+  {
+    std::unique_lock<std::mutex> lock(this->mUpdateMutex);
+    if (mStatus == Status::FINISHED || (mFuture.valid() && mFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready))
+      return false;
+
+    this->mFinishJob = &job;
+    return true;
+  }
+
+  // Set the optional wake-up hook of the main thread, e.g.: posting a window message or writing an eventfd.
+  // It is invoked if onCallbackLoop() has something new to handle (progress, cancellation, finish), but only once until the next onCallbackLoop().
+  // The hook is invoked on the worker thread (or on the cancel()'s), it must be thread-safe and it must not throw.
+  // @MainThread, before execute()
+  void setWakeUpCallback(std::function<void()> fnWakeUp) { this->fnWakeUp = std::move(fnWakeUp); }
+
+  // @MainThread
+  std::function<void()> const& getWakeUpCallback() const noexcept { return this->fnWakeUp; }
+
+  // Block the main thread until the onCallbackLoop() has something new to handle (progress, cancellation, finish) or the timeout is expired.
+  // Return true if there is an update since the last onCallbackLoop().
+  // @MainThread
+  template<typename Rep, typename Period>
+  bool waitForUpdate(std::chrono::duration<Rep, Period> const& timeout)
+  {
+    return waitForUpdateUntil(std::chrono::steady_clock::now() + timeout);
+  }
+
+  // Block the main thread until the onCallbackLoop() has something new to handle (progress, cancellation, finish) or the deadline.
+  // Return true if there is an update since the last onCallbackLoop().
+  // @MainThread
+  template<typename Clock, typename Duration>
+  bool waitForUpdateUntil(std::chrono::time_point<Clock, Duration> const& deadline)
+  {
+    if (mStatus != Status::RUNNING || !mFuture.valid())
+      return mStatus == Status::FINISHED;
+
+    launch();
+    return waitUntil(deadline, true);
+  }
+
+  // Callback loop after waiting for an update (progress, cancellation, finish) at most maxWait, it returns right away if an update is already there.
+  // It replaces the polling loops: onCallbackLoop(std::chrono::milliseconds(100)) wakes up only if there is something to handle.
+  // Return true if the task is finished. Exception from the doInBackground can be rethrown.
+  // @MainThread
+  template<typename Rep, typename Period>
+  bool onCallbackLoop(std::chrono::duration<Rep, Period> const& maxWait)
+  {
+    waitForUpdate(maxWait);
+    return onCallbackLoop();
+  }
+
+  // Get the result if the task is finished within the timeout (see get_until()).
+  // @MainThread
+  template<typename Rep, typename Period>
+  std::optional<Result> get_for(std::chrono::duration<Rep, Period> const& timeout)
+  {
+    return get_until(std::chrono::steady_clock::now() + timeout);
+  }
+
+  // Get the copy of the result if the task is finished until the deadline, otherwise return nullopt and the task keeps running.
+  // Only the finish wakes it up, the progress is not handled during the wait. Exception from the doInBackground can be rethrown.
+  // @MainThread
+  template<typename Clock, typename Duration>
+  std::optional<Result> get_until(std::chrono::time_point<Clock, Duration> const& deadline)
+  {
+    if (mStatus == Status::RUNNING && mFuture.valid())
+    {
+      launch();
+      if (!waitUntil(deadline, false))
+        return std::nullopt;
+    }
+
+    return get();
+  }
+
+  // Get the result.
+  // It could freeze the mainthread if it invoked before the task is finished. Exception from the doInBackground can be rethrown.
+  //@MainThread
+  Result const& get() &
+  {
+    wait();
+    return mResult;
+  }
+
+  // Get the result by moving it out from the rvalue task.
+  //@MainThread
+  Result get() &&
+  {
+    return takeResult();
+  }
+
+  // Get the result by moving it out from the task, later get() will return the moved-from object.
+  // It could freeze the mainthread like get().
+  //@MainThread
+  Result takeResult()
+  {
+    wait();
+    return std::move(mResult);
+  }
+
+  // Callback loop to refresh progress in the feedback system
+  // Return true if the task is finished. Exception from the doInBackground can be rethrown.
+  // @MainThread
+  bool onCallbackLoop()
+  {
+    if (mStatus == Status::FINISHED)
+      return true;
+
+    if (mStatus == Status::PENDING || !mFuture.valid())
+      return false;
+
+    launch();
+    isWakeUpSignaled.store(false);
+    mUpdateCountHandled = mUpdateCount.load();
+
+    if (isCancelled())
+    {
+      finish(mFuture.get());
+      return true;
+    }
+
+    auto const statusThread = mFuture.wait_for(std::chrono::seconds(0));
+
+    switch (statusThread)
+    {
+      case std::future_status::deferred: // Not launched by the executor yet
+      case std::future_status::timeout:
+        this->handlePartialResults(std::numeric_limits<size_t>::max());
+        handleProgress();
+        return false;
+
+      case std::future_status::ready:
+        finishReady();
+        return true;
+
+      default:
+        return false;
+    }
+  }
+
+  // Callback loop within a budget of the callbacks (progress items and the finish), the budget is decreased by the invoked ones. Leftover progress items are kept for the next call.
+  // Unlike onCallbackLoop(), the pending progress items are handled before the onPostExecute().
+  // Return true if the task is finished. Exception from the doInBackground can be rethrown.
+  // @MainThread
+  bool dispatchCallbacks(size_t& nCallbackBudget)
+  {
+    if (mStatus == Status::FINISHED)
+      return true;
+
+    if (mStatus == Status::PENDING || !mFuture.valid() || nCallbackBudget == 0)
+      return false;
+
+    launch();
+    isWakeUpSignaled.store(false);
+    mUpdateCountHandled = mUpdateCount.load();
+
+    if (!isCancelled())
+    {
+      // Readiness is checked first: every progress of a finished worker is already stored.
+      auto const isReady = mFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+      nCallbackBudget -= this->handlePartialResults(nCallbackBudget);
+      this->handleProgressWithin(nCallbackBudget);
+      if (!isReady || nCallbackBudget == 0 || this->getPendingPartialResultCount() > 0 || this->getPendingProgressCount() > 0)
+        return false;
+    }
+
+    --nCallbackBudget;
+    finish(mFuture.get());
+    return true;
+  }
+
+  // Number of the callbacks which are waiting for the callback loop: unhandled partial results and progress items, and the finish
+  // @MainThread
+  size_t getPendingCallbackCount() const
+  {
+    if (mStatus != Status::RUNNING || !mFuture.valid())
+      return 0;
+
+    if (isCancelled())
+      return 1; // Progress is not handled after the cancellation
+
+    auto const isFinishPending = mFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    return this->getPendingPartialResultCount() + this->getPendingProgressCount() + (isFinishPending ? 1 : 0);
+  }
+
+private:
+  // Block until the worker finishes, also until any update if isAnyUpdate, or until the deadline. Return true if the awaited event is happened.
+  // The progress and the cancellation notify only the waiters of any update (see notifyUpdate()), the finish notifies every waiter.
+  // @MainThread
+  template<typename Clock, typename Duration>
+  bool waitUntil(std::chrono::time_point<Clock, Duration> const& deadline, bool isAnyUpdate)
+  {
+    std::unique_lock<std::mutex> lock(this->mUpdateMutex);
+    auto const isReady = [this] { return this->mFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }; // The worker sets the result under the lock
+    if (!isAnyUpdate)
+      return this->mUpdateCondition.wait_until(lock, deadline, isReady);
+
+    this->mUpdateWaiterCount.fetch_add(1);
+    auto const isUpdated = this->mUpdateCondition.wait_until(lock, deadline, [this] { return this->mUpdateCount.load() != this->mUpdateCountHandled; });
+    this->mUpdateWaiterCount.fetch_sub(1);
+    return isUpdated;
+  }
+
+  // @MainThread
+  void wait()
+  {
+    if (getStatus() == Status::FINISHED)
+      return;
+
+    if (getStatus() == Status::RUNNING)
+    {
+      launch();
+      detachProgress();
+    }
+
+    mFuture.wait();
+    finishReady();
+  }
+
+  // The remaining partial results are handled before the finish, the future is kept valid if their handler throws
+  // @MainThread
+  void finishReady()
+  {
+    if (!isCancelled())
+      this->handlePartialResults(std::numeric_limits<size_t>::max());
+
+    finish(mFuture.get());
+  }
+
+  // @MainThread
+  void finish(Result&& result)
+  {
+    {
+      // The worker could still notify about the finish: after this, no more wake-up is invoked.
+      std::unique_lock<std::mutex> lock(this->mUpdateMutex);
+    }
+
+    if (this->mStats)
+      recordTime(this->mStats->tDispatch);
+
+    mResult = std::move(result);
+    if (isCancelled())
+      onCancelled(mResult);
+    else
+      onPostExecute(mResult);
+
+    mStatus = Status::FINISHED;
+#ifndef ASYNCTASK_NO_STATS
+    if (this->mStats && this->mTraceSink)
+      this->mTraceSink->onTaskFinished(this, *this->getStats());
+#endif
+
+    if (isExceptionRethrowNeededOnMainThread.load() && eptr)
+      std::rethrow_exception(eptr);
+  }
+};
+
+
+// Progress storage strategy of the AsyncTask
+enum class AsyncTaskProgressStorage : int
+{
+  Atomic, // std::atomic<Progress>
+  SeqLock, // Trivially copyable Progress in atomic words guarded by sequence counter: store() never waits for load(), load() retries if it was overlapped.
+  Mutex, // Mutex guarded Progress, load() and store() wait for each other
+  TripleBuffer // Lock-free triple buffer: the worker never waits for the main thread, the main thread handles the latest complete Progress without copy. Single producer only.
+};
+
+
+// Select the progress storage of the AsyncTask<Progress, ...>, it could be specialized for user-defined Progress types.
+//  - std::atomic is used only if it is lock-free, oversized trivially copyable types would share the global lock table of the libatomic.
+// E.g.: template<> struct AsyncTaskProgressStorageOf<Image> { static AsyncTaskProgressStorage constexpr value = AsyncTaskProgressStorage::TripleBuffer; };
+template<typename Progress, typename = void>
+struct AsyncTaskProgressStorageOf
+{
+  static bool constexpr isAtomicCompatible = std::is_trivially_copyable_v<Progress>
+    && std::is_copy_constructible_v<Progress>
+    && std::is_move_constructible_v<Progress>
+    && std::is_copy_assignable_v<Progress>
+    && std::is_move_assignable_v<Progress>;
+
+  static constexpr bool isAtomicLockFree()
+  {
+    if constexpr (isAtomicCompatible)
+      return std::atomic<Progress>::is_always_lock_free;
+    else
+      return false;
+  }
+
+  static AsyncTaskProgressStorage constexpr value = isAtomicLockFree()
+    ? AsyncTaskProgressStorage::Atomic
+    : isAtomicCompatible
+      ? (std::is_default_constructible_v<Progress> ? AsyncTaskProgressStorage::SeqLock : AsyncTaskProgressStorage::Atomic)
+      : AsyncTaskProgressStorage::Mutex;
+};
+
+
+// General AsyncTask
+template<typename Progress, typename Result, typename... Params>
+class AsyncTask : public AsyncTaskBase<Progress, Result, Params...>
+{
+private:
+  // Progress handling
+#ifndef ASYNCTASK_NO_MUTEX_STORAGE
+  template<typename Data>
+  struct ThreadSafeContainer
+  {
+  private:
+    Data mData{};
+    mutable std::mutex mMutex{};
+
+  public:
+    ThreadSafeContainer() = default;
+    ThreadSafeContainer(ThreadSafeContainer const&) = delete;
+    ThreadSafeContainer(ThreadSafeContainer&&) = delete;
+    ThreadSafeContainer& operator=(ThreadSafeContainer const&) = delete;
+    ThreadSafeContainer& operator=(ThreadSafeContainer&&) = delete;
+
+    void store(Data const& data)
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mData = data;
+    }
+
+    void store(Data&& data)
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mData = std::move(data);
+    }
+
+    Data load() const
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      return mData;
+    }
+  };
+#endif // !ASYNCTASK_NO_MUTEX_STORAGE
+
+  template<typename Data>
+  struct SeqLockContainer
+  {
+  private:
+    using Word = uintptr_t;
+    static size_t constexpr nWord = (sizeof(Data) + sizeof(Word) - 1) / sizeof(Word);
+    using Words = std::array<Word, nWord>;
+
+    std::atomic<uint64_t> mSequence = { 0 }; // Odd during the store
+    std::array<std::atomic<Word>, nWord> mData;
+
+  public:
+    SeqLockContainer() noexcept { store(Data{}); }
+    SeqLockContainer(SeqLockContainer const&) = delete;
+    SeqLockContainer(SeqLockContainer&&) = delete;
+    SeqLockContainer& operator=(SeqLockContainer const&) = delete;
+    SeqLockContainer& operator=(SeqLockContainer&&) = delete;
+
+    void store(Data const& data) noexcept
+    {
+      auto words = Words{};
+      std::memcpy(words.data(), &data, sizeof(Data));
+
+      // Writers are serialized by the odd sequence, readers never block them.
+      auto sequence = mSequence.load(std::memory_order_relaxed);
+      for (;;)
+      {
+        if (sequence & 1)
+        {
+          std::this_thread::yield();
+          sequence = mSequence.load(std::memory_order_relaxed);
+        }
+        else if (mSequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire, std::memory_order_relaxed))
+          break;
+      }
+      std::atomic_thread_fence(std::memory_order_release);
+
+      for (size_t i = 0; i < nWord; ++i)
+        mData[i].store(words[i], std::memory_order_relaxed);
+
+      mSequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    Data load() const noexcept
+    {
+      auto words = Words{};
+      for (;;)
+      {
+        auto const sequence = mSequence.load(std::memory_order_acquire);
+        if (sequence & 1)
+        {
+          std::this_thread::yield();
+          continue;
+        }
+
+        for (size_t i = 0; i < nWord; ++i)
+          words[i] = mData[i].load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (mSequence.load(std::memory_order_relaxed) == sequence)
+          break;
+      }
+
+      Data data;
+      std::memcpy(static_cast<void*>(&data), words.data(), sizeof(Data));
+      return data;
+    }
+  };
+
+  template<typename Data>
+  struct TripleBufferContainer
+  {
+  private:
+    static uint8_t constexpr isFreshBit = 4;
+    static uint8_t constexpr indexMask = 3;
+
+    std::array<Data, 3> mData{};
+    alignas(64) std::atomic<uint8_t> mMiddle = { 1 }; // Index of the latest stored Data, with isFreshBit if it is not loaded yet
+    alignas(64) uint8_t mBack = 0; // @WorkerThread
+    alignas(64) uint8_t mFront = 2; // @MainThread
+
+  public:
+    TripleBufferContainer() = default;
+    TripleBufferContainer(TripleBufferContainer const&) = delete;
+    TripleBufferContainer(TripleBufferContainer&&) = delete;
+    TripleBufferContainer& operator=(TripleBufferContainer const&) = delete;
+    TripleBufferContainer& operator=(TripleBufferContainer&&) = delete;
+
+    template<typename DataT>
+    void store(DataT&& data)
+    {
+      mData[mBack] = std::forward<DataT>(data);
+      mBack = mMiddle.exchange(mBack | isFreshBit, std::memory_order_acq_rel) & indexMask;
+    }
+
+    // The reference is valid until the next load()
+    Data const& load() noexcept
+    {
+      if (mMiddle.load(std::memory_order_relaxed) & isFreshBit)
+        mFront = mMiddle.exchange(mFront, std::memory_order_acq_rel) & indexMask;
+
+      return mData[mFront];
+    }
+  };
+
+public:
+  // Applied progress storage strategy
+  static AsyncTaskProgressStorage constexpr progressStorage = AsyncTaskProgressStorageOf<Progress>::value;
+
+  static_assert(progressStorage != AsyncTaskProgressStorage::Atomic || std::is_trivially_copyable_v<Progress>, "Atomic progress storage requires trivially copyable Progress.");
+  static_assert(progressStorage != AsyncTaskProgressStorage::SeqLock || std::is_trivially_copyable_v<Progress>, "SeqLock progress storage requires trivially copyable Progress.");
+
+private:
+#ifdef ASYNCTASK_NO_MUTEX_STORAGE
+  static_assert(progressStorage != AsyncTaskProgressStorage::Mutex, "Mutex progress storage is excluded by ASYNCTASK_NO_MUTEX_STORAGE, specialize AsyncTaskProgressStorageOf (e.g.: TripleBuffer) for this Progress.");
   template<typename Data>
-  struct ThreadSafeQueue
+  using ThreadSafeContainer = TripleBufferContainer<Data>; // Only to keep the rejected instantiation short
+#endif
+
+  using ProgressContainer = std::conditional_t<progressStorage == AsyncTaskProgressStorage::Atomic
+    , std::atomic<Progress>
+    , std::conditional_t<progressStorage == AsyncTaskProgressStorage::SeqLock
+      , SeqLockContainer<Progress>
+      , std::conditional_t<progressStorage == AsyncTaskProgressStorage::TripleBuffer
+        , TripleBufferContainer<Progress>
+        , ThreadSafeContainer<Progress>
+      >
+    >
+  >;
+
+  ProgressContainer mProgress;
+  std::atomic<uint64_t> mProgressSequence = { 0 }; // Number of the stored progresses, incremented after the store
+  uint64_t mProgressSequenceHandled = 0; // @MainThread
+
+protected:
+
+  // Store the current state of the progress inside the class
+  // @WorkerThread
+  void storeProgress(Progress const& progress) override
+  {
+    if (auto const movableProgress = this->getMovableProgress(progress))
+      this->storeProgressDirect(std::move(*movableProgress));
+    else
+      this->storeProgressDirect(progress);
+  }
+
+  // Non-virtual store of the progress, the sequence's release publishes it: atomic Progress is stored by relaxed order.
+  // @WorkerThread
+  template<typename ProgressT>
+  void storeProgressDirect(ProgressT&& progress)
+  {
+    if constexpr (progressStorage == AsyncTaskProgressStorage::Atomic)
+      this->mProgress.store(progress, std::memory_order_relaxed);
+    else
+      this->mProgress.store(std::forward<ProgressT>(progress));
+
+    this->mProgressSequence.fetch_add(1, std::memory_order_release);
+  }
+
+  // The last progress is kept in the storage, but it is not handled again.
+  // @MainThread
+  void resetProgress() override
+  {
+    this->mProgressSequenceHandled = this->mProgressSequence.load(std::memory_order_acquire);
+  }
+
+  // Show progress in the feedback system
+  // @MainThread
+  virtual void onProgressUpdate(Progress const&) {}
+
+protected:
+  virtual void handleProgress() override final
+  {
+    // Sequence is read before the load: a concurrent store is handled at the next time again, but it is never missed.
+    auto const sequence = this->mProgressSequence.load(std::memory_order_acquire);
+    if (sequence == this->mProgressSequenceHandled)
+      return;
+
+    this->mProgressSequenceHandled = sequence;
+    this->onProgressUpdate(mProgress.load());
+  }
+
+  // Only the latest progress is kept, it is one item
+  void handleProgressWithin(size_t& nItemBudget) override final
+  {
+    if (nItemBudget == 0 || !this->hasNewProgress())
+      return;
+
+    this->handleProgress();
+    --nItemBudget;
+  }
+
+  size_t getPendingProgressCount() const override final { return this->hasNewProgress() ? 1 : 0; }
+
+public:
+  using AsyncTaskBase<Progress, Result, Params...>::AsyncTaskBase;
+
+  // Return true if progress is published since the last onProgressUpdate(), e.g.: redraw could be skipped if it is false.
+  // @MainThread
+  bool hasNewProgress() const noexcept { return this->mProgressSequence.load(std::memory_order_acquire) != this->mProgressSequenceHandled; }
+};
+
+
+// AsyncTaskStatic: AsyncTask with statically bound progress store
+//  - publishProgress() reaches the AsyncTask's progress storage without virtual call, it can be inlined into the loop of the doInBackground().
+//  - The progress storage is final, storeProgress() cannot be overridden. Other hooks are defined as in AsyncTask, they are invoked once per run (or per onCallbackLoop()).
+template<typename Progress, typename Result, typename... Params>
+class AsyncTaskStatic : public AsyncTask<Progress, Result, Params...>
+{
+protected:
+  void storeProgress(Progress const& progress) override final
+  {
+    AsyncTask<Progress, Result, Params...>::storeProgress(progress);
+  }
+
+public:
+  using AsyncTask<Progress, Result, Params...>::AsyncTask;
+
+  // Store the current state of the progress without virtual call
+  // Use inside the doInBackground()
+  // @WorkerThread
+  void publishProgress(Progress const& progress)
+  {
+    this->publishProgressBy(progress, [this](Progress const& progressStored) { this->storeProgressDirect(progressStored); });
+  }
+
+  // Store the current state of the progress without virtual call and copy
+  // Use inside the doInBackground()
+  // @WorkerThread
+  void publishProgress(Progress&& progress)
+  {
+    this->publishProgressBy(std::move(progress), [this](Progress& progressStored) { this->storeProgressDirect(std::move(progressStored)); });
+  }
+};
+
+
+#ifndef ASYNCTASK_NO_PQ
+
+// Contiguous read-only view of the progress items, it is std::span<T const> if it is available
+#ifdef __cpp_lib_span
+template<typename T>
+using AsyncTaskSpan = std::span<T const>;
+#else
+template<typename T>
+class AsyncTaskSpan
+{
+private:
+  T const* mData = nullptr;
+  size_t mSize = 0;
+
+public:
+  constexpr AsyncTaskSpan() noexcept = default;
+  constexpr AsyncTaskSpan(T const* data, size_t size) noexcept : mData(data), mSize(size) {}
+
+  constexpr T const* data() const noexcept { return mData; }
+  constexpr size_t size() const noexcept { return mSize; }
+  constexpr bool empty() const noexcept { return mSize == 0; }
+  constexpr T const* begin() const noexcept { return mData; }
+  constexpr T const* end() const noexcept { return mData + mSize; }
+  constexpr T const& operator[](size_t i) const noexcept { return mData[i]; }
+  constexpr T const& front() const noexcept { return mData[0]; }
+  constexpr T const& back() const noexcept { return mData[mSize - 1]; }
+};
+#endif
+
+
+// Overflow policy of the bounded progress queue (AsyncTaskPQRingBuffer)
+enum class AsyncTaskOverflowPolicy : int
+{
+  Block, // The worker waits until the main thread makes room (or the task is cancelled, or the main thread waits in get()).
+  DropOldest, // The oldest unhandled item is dropped.
+  Coalesce // The worker merges the new item into the not yet queued last one by isLastShouldBeAltered(), if it is not possible, it waits like Block.
+};
+
+
+// Unbounded progress queue, guarded by mutex. Its storage is allocated from the task's memory resource.
+//  - Items are contiguous: the producer's and the consumer's vectors are swapped at the consumption, so their capacity is reused.
+template<typename Data>
+class AsyncTaskProgressQueue
+{
+private:
+  std::pmr::vector<Data> mData;
+  std::pmr::vector<Data> mDataConsumed; // @MainThread: it is swapped with the mData, so both capacities are reused
+  size_t mConsumedBegin = 0; // @MainThread: items of mDataConsumed are leftover from this index (limited consumption)
+  mutable std::mutex mMutex{};
+
+public:
+  AsyncTaskProgressQueue() : AsyncTaskProgressQueue(*std::pmr::get_default_resource()) {}
+  explicit AsyncTaskProgressQueue(std::pmr::memory_resource& memoryResource) : mData(&memoryResource), mDataConsumed(&memoryResource) {}
+  AsyncTaskProgressQueue(AsyncTaskProgressQueue const&) = delete;
+  AsyncTaskProgressQueue(AsyncTaskProgressQueue&&) = delete;
+  AsyncTaskProgressQueue& operator=(AsyncTaskProgressQueue const&) = delete;
+  AsyncTaskProgressQueue& operator=(AsyncTaskProgressQueue&&) = delete;
+
+  // @WorkerThread
+  template<typename DataT, typename BinaryAlteration, typename Interruption>
+  AsyncTaskProgressStoreResult store(DataT&& data, BinaryAlteration&& fnLastShouldBeAltered, Interruption&&)
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (!mData.empty())
+    {
+      auto oData = fnLastShouldBeAltered(mData.back(), static_cast<Data const&>(data));
+      if (oData.has_value())
+      {
+        mData.back() = std::move(oData.value());
+        return { mData.size(), true, 0 };
+      }
+    }
+
+    mData.push_back(std::forward<DataT>(data));
+    return { mData.size(), false, 0 };
+  }
+
+  // @WorkerThread
+  template<typename Interruption>
+  void flush(Interruption&&) {}
+
+  // @MainThread
+  void detach() noexcept {}
+
+  // Drop the unconsumed items
+  // @MainThread, if the producer is not running
+  void reset() noexcept
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mData.clear();
+    mDataConsumed.clear();
+    mConsumedBegin = 0;
+  }
+
+  // Number of the unconsumed items
+  // @MainThread
+  size_t size() const
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    return mData.size() + mDataConsumed.size() - mConsumedBegin;
+  }
+
+  // @MainThread
+  template<typename Consumer>
+  void consume(Consumer&& fnConsumer)
+  {
+    consumeBatch([&](Data const* data, size_t size)
+    {
+      for (size_t i = 0; i < size; ++i)
+        fnConsumer(data[i]);
+    });
+  }
+
+  // Consumes the queued items by calls of fnBatchConsumer(data, size), at most nMax items. Return the number of the consumed ones.
+  // The leftover of the earlier limited consumption is consumed first, then the newly queued ones (in one call if there is no leftover).
+  // The consumer could move from the items, they are dropped after the call.
+  // @MainThread
+  template<typename BatchConsumer>
+  size_t consumeBatch(BatchConsumer&& fnBatchConsumer, size_t nMax = std::numeric_limits<size_t>::max())
+  {
+    size_t nConsumed = 0;
+    for (auto isSwapped = false; nConsumed < nMax;)
+    {
+      if (mConsumedBegin == mDataConsumed.size())
+      {
+        if (std::exchange(isSwapped, true))
+          break;
+
+        mDataConsumed.clear();
+        mConsumedBegin = 0;
+        {
+          std::unique_lock<std::mutex> lock(mMutex);
+          mDataConsumed.swap(mData); // Same allocator, no reallocation
+        }
+
+        if (mDataConsumed.empty())
+          break;
+      }
+
+      auto const nBatch = std::min(nMax - nConsumed, mDataConsumed.size() - mConsumedBegin);
+      auto const iBegin = std::exchange(mConsumedBegin, mConsumedBegin + nBatch); // The batch is consumed even if the consumer throws
+      nConsumed += nBatch;
+      if constexpr (std::is_same_v<Data, bool>)
+      {
+        for (size_t i = iBegin; i < iBegin + nBatch; ++i) // std::vector<bool> is not contiguous
+        {
+          bool data = mDataConsumed[i];
+          fnBatchConsumer(&data, size_t(1));
+        }
+      }
+      else
+        fnBatchConsumer(mDataConsumed.data() + iBegin, nBatch);
+    }
+
+    if (mConsumedBegin == mDataConsumed.size())
+    {
+      mDataConsumed.clear();
+      mConsumedBegin = 0;
+    }
+    return nConsumed;
+  }
+};
+
+
+// Bounded, lock-free single-producer/single-consumer progress queue
+//  - Items are stored in a preallocated array, the queue and the free-list are rings of item indices. Item's copy assignment could reuse the capacity of the earlier published ones.
+//  - Nothing is allocated after the construction.
+//  - If the queue is full (Block, Coalesce), the producer sleeps on a condition variable. The consumer wakes it after it frees slots, the cancellation of the store()'s token and detach() also wake it.
+//  - The main thread could be the consumer, the worker thread (which calls the publishProgress()) must be the only one producer.
+template<typename Data, size_t Capacity, AsyncTaskOverflowPolicy Overflow>
+class AsyncTaskProgressRingBuffer
+{
+  static_assert(Capacity > 0, "Capacity of the progress ring buffer must be positive.");
+
+private:
+  static size_t constexpr nCacheLine = 64;
+  static size_t constexpr nItem = Capacity + 2; // Queued ones + producer's spare + consumer's current one
+
+  std::array<Data, nItem> mItems{};
+  std::array<Data, Capacity> mBatch{}; // Consumer's contiguous items of consumeBatch()
+  std::array<std::atomic<size_t>, Capacity> mQueue;
+  std::array<std::atomic<size_t>, nItem> mFreeList;
+
+  alignas(nCacheLine) std::atomic<size_t> mQueueHead = { 0 }; // Written by the producer
+  alignas(nCacheLine) std::atomic<size_t> mQueueTail = { 0 }; // Written by the consumer (and the producer at DropOldest)
+  alignas(nCacheLine) std::atomic<size_t> mFreeListHead = { 0 }; // Written by the consumer
+  std::atomic_bool mIsDetached = { false };
+
+  // Sleeping producer of the full queue
+  std::atomic_bool mIsProducerWaiting = { false };
+  std::mutex mWaitMutex;
+  std::condition_variable mWaitCondition;
+
+  // Producer's own state
+  alignas(nCacheLine) size_t mFreeListTail = 0;
+  size_t mSpare = 0;
+  bool mIsSparePending = false; // Coalesce: spare holds an item which is not queued yet
+
+public:
+  AsyncTaskProgressRingBuffer() noexcept
+  {
+    reset();
+  }
+
+  explicit AsyncTaskProgressRingBuffer(std::pmr::memory_resource&) noexcept : AsyncTaskProgressRingBuffer() {}
+
+  AsyncTaskProgressRingBuffer(AsyncTaskProgressRingBuffer const&) = delete;
+  AsyncTaskProgressRingBuffer(AsyncTaskProgressRingBuffer&&) = delete;
+  AsyncTaskProgressRingBuffer& operator=(AsyncTaskProgressRingBuffer const&) = delete;
+  AsyncTaskProgressRingBuffer& operator=(AsyncTaskProgressRingBuffer&&) = delete;
+
+  // The producer does not wait for a free slot anymore if the cancellation is requested, the item is dropped.
+  // @WorkerThread
+  template<typename DataT, typename BinaryAlteration>
+  AsyncTaskProgressStoreResult store(DataT&& data, BinaryAlteration&& fnLastShouldBeAltered, AsyncTaskCancellationToken const& cancellation)
+  {
+    auto result = AsyncTaskProgressStoreResult{};
+    if (mIsSparePending)
+    {
+      if (!tryPush(result.nDropped))
+      {
+        auto oData = fnLastShouldBeAltered(static_cast<Data const&>(mItems[mSpare]), static_cast<Data const&>(data));
+        if (oData.has_value())
+        {
+          mItems[mSpare] = std::move(oData.value());
+          result.isCoalesced = true;
+          return getQueued(result);
+        }
+
+        if (!waitPush(cancellation, result.nDropped))
+        {
+          ++result.nDropped;
+          return getQueued(result);
+        }
+      }
+      mIsSparePending = false;
+    }
+
+    mItems[mSpare] = std::forward<DataT>(data);
+    if (tryPush(result.nDropped))
+      return getQueued(result);
+
+    if constexpr (Overflow == AsyncTaskOverflowPolicy::Coalesce)
+      mIsSparePending = true;
+    else if (!waitPush(cancellation, result.nDropped))
+      ++result.nDropped; // Item is dropped if it is interrupted
+
+    return getQueued(result);
+  }
+
+  // Enqueue the pending item at the end of the doInBackground()
+  // @WorkerThread
+  void flush(AsyncTaskCancellationToken const& cancellation)
+  {
+    size_t nDropped = 0;
+    if (mIsSparePending && waitPush(cancellation, nDropped))
+      mIsSparePending = false;
+  }
+
+  // Consumer will not consume anymore, the producer should not wait for it.
+  // @MainThread
+  void detach() noexcept
+  {
+    mIsDetached.store(true);
+    wakeUpProducer();
+  }
+
+  // Drop the unconsumed items, the items' objects are kept for reuse.
+  // @MainThread, if the producer is not running
+  void reset() noexcept
+  {
+    for (auto& index : mQueue)
+      index.store(0, std::memory_order_relaxed);
+
+    for (size_t i = 1; i < nItem; ++i)
+      mFreeList[i - 1].store(i, std::memory_order_relaxed);
+
+    mQueueHead.store(0, std::memory_order_relaxed);
+    mQueueTail.store(0, std::memory_order_relaxed);
+    mFreeListHead.store(nItem - 1, std::memory_order_relaxed);
+    mIsDetached.store(false, std::memory_order_relaxed);
+    mFreeListTail = 0;
+    mSpare = 0;
+    mIsSparePending = false;
+  }
+
+  // Consumes the items which were queued before the call
+  // @MainThread
+  template<typename Consumer>
+  void consume(Consumer&& fnConsumer)
+  {
+    auto const head = mQueueHead.load(std::memory_order_acquire);
+    for (auto tail = mQueueTail.load(std::memory_order_acquire); tail < head; tail = mQueueTail.load(std::memory_order_acquire))
+    {
+      auto const index = mQueue[tail % Capacity].load(std::memory_order_relaxed);
+      if (!mQueueTail.compare_exchange_weak(tail, tail + 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+        continue; // Producer dropped it meanwhile
+
+      try
+      {
+        fnConsumer(static_cast<Data const&>(mItems[index]));
+      }
+      catch (...)
+      {
+        pushFreeList(index);
+        notifyProducer();
+        throw;
+      }
+      pushFreeList(index);
+    }
+    notifyProducer();
+  }
+
+  // Consumes the items which were queued before the call (at most nMax) by one call of fnBatchConsumer(data, size), if there is any. Return the number of the consumed ones.
+  // The items are swapped into the consumer's batch, their slots get back the objects of the earlier batch for reuse.
+  // @MainThread
+  template<typename BatchConsumer>
+  size_t consumeBatch(BatchConsumer&& fnBatchConsumer, size_t nMax = std::numeric_limits<size_t>::max())
+  {
+    size_t nBatch = 0;
+    auto const head = mQueueHead.load(std::memory_order_acquire);
+    for (auto tail = mQueueTail.load(std::memory_order_acquire); tail < head && nBatch < nMax; tail = mQueueTail.load(std::memory_order_acquire))
+    {
+      auto const index = mQueue[tail % Capacity].load(std::memory_order_relaxed);
+      if (!mQueueTail.compare_exchange_weak(tail, tail + 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+        continue; // Producer dropped it meanwhile
+
+      try
+      {
+        using std::swap;
+        swap(mBatch[nBatch], mItems[index]);
+      }
+      catch (...)
+      {
+        pushFreeList(index);
+        notifyProducer();
+        throw;
+      }
+      pushFreeList(index);
+      ++nBatch;
+    }
+
+    if (nBatch == 0)
+      return nBatch;
+
+    notifyProducer(); // The items are swapped out, the producer could continue during the batch's handling
+    fnBatchConsumer(static_cast<Data const*>(mBatch.data()), nBatch);
+
+    return nBatch;
+  }
+
+  // Number of the queued items
+  // @MainThread
+  size_t size() const noexcept
+  {
+    auto const tail = mQueueTail.load(std::memory_order_acquire);
+    return mQueueHead.load(std::memory_order_acquire) - tail;
+  }
+
+private:
+  // Length of the queue, including the pending item of Coalesce
+  // @WorkerThread
+  AsyncTaskProgressStoreResult getQueued(AsyncTaskProgressStoreResult result) const noexcept
+  {
+    result.nQueued = mQueueHead.load(std::memory_order_relaxed) - mQueueTail.load(std::memory_order_relaxed) + (mIsSparePending ? 1 : 0);
+    return result;
+  }
+
+  // @WorkerThread
+  bool tryPush(size_t& nDropped) noexcept
+  {
+    auto const head = mQueueHead.load(std::memory_order_relaxed);
+    auto tail = mQueueTail.load(std::memory_order_acquire);
+    for (;;)
+    {
+      if (head - tail < Capacity)
+      {
+        enqueue(head, mSpare);
+        mSpare = popFreeList();
+        return true;
+      }
+
+      if constexpr (Overflow != AsyncTaskOverflowPolicy::DropOldest)
+        return false;
+      else
+      {
+        auto const indexDropped = mQueue[tail % Capacity].load(std::memory_order_relaxed);
+        if (!mQueueTail.compare_exchange_weak(tail, tail + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+          continue; // Consumer took it, tail is reloaded
+
+        enqueue(head, mSpare);
+        mSpare = indexDropped;
+        ++nDropped;
+        return true;
+      }
+    }
+  }
+
+  // Sleep until the consumer frees a slot. Return false if it is detached or cancelled meanwhile.
+  // @WorkerThread
+  bool waitPush(AsyncTaskCancellationToken const& cancellation, size_t& nDropped)
+  {
+    if (tryPush(nDropped))
+      return true;
+
+    auto const cancelCallback = AsyncTaskCancelCallback(cancellation, [this] { this->wakeUpProducer(); });
+    std::unique_lock<std::mutex> lock(mWaitMutex);
+    mIsProducerWaiting.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst); // Pairs with the notifyProducer()'s fence: either the consumer sees the flag, or the tryPush() sees the freed slot.
+    auto isPushed = tryPush(nDropped);
+    while (!isPushed && !mIsDetached.load() && !cancellation.isCancelled())
+    {
+      mWaitCondition.wait(lock);
+      isPushed = tryPush(nDropped);
+    }
+
+    mIsProducerWaiting.store(false, std::memory_order_relaxed);
+    return isPushed;
+  }
+
+  // Wake up the sleeping producer if there is any, after the slots are freed
+  // @MainThread
+  void notifyProducer() noexcept
+  {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (mIsProducerWaiting.load(std::memory_order_relaxed))
+      wakeUpProducer();
+  }
+
+  void wakeUpProducer() noexcept
+  {
+    std::unique_lock<std::mutex> lock(mWaitMutex);
+    mWaitCondition.notify_one();
+  }
+
+  // @WorkerThread
+  void enqueue(size_t head, size_t index) noexcept
+  {
+    mQueue[head % Capacity].store(index, std::memory_order_relaxed);
+    mQueueHead.store(head + 1, std::memory_order_release);
+  }
+
+  // @WorkerThread
+  size_t popFreeList() noexcept
+  {
+    // The free-list cannot be empty, only the consumer's release could be still in flight.
+    while (mFreeListTail == mFreeListHead.load(std::memory_order_acquire))
+      std::this_thread::yield();
+
+    return mFreeList[mFreeListTail++ % nItem].load(std::memory_order_relaxed);
+  }
+
+  // @MainThread
+  void pushFreeList(size_t index) noexcept
+  {
+    auto const head = mFreeListHead.load(std::memory_order_relaxed);
+    mFreeList[head % nItem].store(index, std::memory_order_relaxed);
+    mFreeListHead.store(head + 1, std::memory_order_release);
+  }
+};
+
+
+// AsyncTaskPQBase: Common base of the progress queue based AsyncTasks, ProgressQueue defines the storage of the progress items
+template<typename ProgressQueue, typename Progress, typename Result, typename... Params>
+class AsyncTaskPQBase : public AsyncTaskBase<Progress, Result, Params...>
+{
+private:
+  ProgressQueue mProgressQueue{ this->getMemoryResource() };
+
+  // Progress reduction handling, its state is used only by the publishing worker
+  AsyncTaskProgressReduction mReduction{};
+  bool isReductionEnabled = false;
+  size_t nProgressReduced = 0;
+  std::chrono::steady_clock::time_point mProgressReducedAt{};
+  std::optional<Progress> mProgressReduced{};
+
+public:
+  // Set the worker-side reduction of the progress items (see AsyncTaskProgressReduction and combine()), a default constructed one disables it.
+  // Log-style progress could be queued in far less items (and queue lock acquisitions).
+  // @MainThread, before execute()
+  void setProgressReduction(AsyncTaskProgressReduction const& reduction) noexcept
+  {
+    this->mReduction = reduction;
+    this->isReductionEnabled = reduction.maxItems > 1 || (reduction.maxItems == 0 && reduction.maxInterval > std::chrono::steady_clock::duration::zero());
+  }
+
+protected:
+
+  // To define condition when not all progress item wanted to be stored. It will be used in thread-safe environment.
+  // @WorkerThread 
+  virtual std::optional<Progress> isLastShouldBeAltered(Progress const& /*progressOld*/, Progress const& /*progressNew*/) const { return std::nullopt; }
+
+  // Merge the next progress into the accumulated one if the reduction is enabled (see setProgressReduction()), e.g.: append the next log lines to the accumulated ones.
+  // It is invoked outside of the queue's lock. Default: the next one is kept.
+  // @WorkerThread
+  virtual Progress combine(Progress&& /*progressAccumulated*/, Progress&& progressNext) const { return std::move(progressNext); }
+
+  // Store the current state of the progress inside the class
+  // @WorkerThread
+  void storeProgress(Progress const& progress) override
+  {
+    if (this->isReductionEnabled)
+      return this->reduceProgress(progress);
+
+    // or use overrideLast() in special cases.
+    auto const movableProgress = this->getMovableProgress(progress);
+    auto const result = movableProgress
+      ? this->mProgressQueue.store(std::move(*movableProgress), this->getLastAlteration(), this->getInterruption())
+      : this->mProgressQueue.store(progress, this->getLastAlteration(), this->getInterruption());
+
+    this->recordProgressStore(result);
+  }
+
+  // @WorkerThread
+  void flushProgress() override
+  {
+    this->storeReducedProgress();
+    this->mProgressQueue.flush(this->getInterruption());
+  }
+
+  // @MainThread
+  void detachProgress() override
+  {
+    this->mProgressQueue.detach();
+  }
+
+  // @MainThread
+  void resetProgress() override
+  {
+    this->mProgressQueue.reset();
+    this->mProgressReduced.reset();
+    this->nProgressReduced = 0;
+  }
+
+  // Show progress in the feedback system
+  // @MainThread
+  virtual void onProgressUpdate(Progress const&) {}
+
+  // Show every progress item at once which is queued since the last handling, in the published order (e.g.: to coalesce the redraws of the feedback system).
+  // The items are valid only during the call. Default: onProgressUpdate() is invoked for each one.
+  // @MainThread
+  virtual void onProgressUpdateBatch(AsyncTaskSpan<Progress> progressItems)
+  {
+    for (auto const& progress : progressItems)
+      this->onProgressUpdate(progress);
+  }
+
+protected:
+  virtual void handleProgress() override final
+  {
+    this->mProgressQueue.consumeBatch([this](Progress const* progressItems, size_t size) { this->onProgressUpdateBatch(AsyncTaskSpan<Progress>(progressItems, size)); });
+  }
+
+  void handleProgressWithin(size_t& nItemBudget) override final
+  {
+    nItemBudget -= this->mProgressQueue.consumeBatch([this](Progress const* progressItems, size_t size) { this->onProgressUpdateBatch(AsyncTaskSpan<Progress>(progressItems, size)); }, nItemBudget);
+  }
+
+  size_t getPendingProgressCount() const override final { return this->mProgressQueue.size(); }
+
+private:
+  auto getLastAlteration() const noexcept
+  {
+    return [this](Progress const& progressOld, Progress const& progressNew) { return this->isLastShouldBeAltered(progressOld, progressNew); };
+  }
+
+  // The blocking stores of the progress queue are interrupted by the cancellation
+  AsyncTaskCancellationToken getInterruption() noexcept { return this->getCancellationToken(); }
+
+  // Merge the progress into the accumulator, it is queued if a threshold is reached
+  // @WorkerThread
+  void reduceProgress(Progress const& progress)
+  {
+    auto const isTimed = this->mReduction.maxInterval > std::chrono::steady_clock::duration::zero();
+    auto const now = isTimed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+    auto const movableProgress = this->getMovableProgress(progress);
+    if (!this->mProgressReduced)
+    {
+      if (movableProgress)
+        this->mProgressReduced.emplace(std::move(*movableProgress));
+      else
+        this->mProgressReduced.emplace(progress);
+
+      this->nProgressReduced = 1;
+      this->mProgressReducedAt = now;
+    }
+    else
+    {
+      *this->mProgressReduced = movableProgress
+        ? this->combine(std::move(*this->mProgressReduced), std::move(*movableProgress))
+        : this->combine(std::move(*this->mProgressReduced), Progress(progress));
+
+      ++this->nProgressReduced;
+      this->recordProgressStore(AsyncTaskProgressStoreResult{ 0, true, 0 });
+    }
+
+    auto const isFull = this->mReduction.maxItems > 0 && this->nProgressReduced >= this->mReduction.maxItems;
+    auto const isExpired = isTimed && now - this->mProgressReducedAt >= this->mReduction.maxInterval;
+    if (isFull || isExpired)
+      this->storeReducedProgress();
+    else
+      this->holdBackStoredProgress();
+  }
+
+  // Queue the accumulator
+  // @WorkerThread
+  void storeReducedProgress()
+  {
+    if (!this->mProgressReduced)
+      return;
+
+    auto const result = this->mProgressQueue.store(std::move(*this->mProgressReduced), this->getLastAlteration(), this->getInterruption());
+    this->mProgressReduced.reset();
+    this->nProgressReduced = 0;
+    this->recordProgressStore(result);
+  }
+
+public:
+  using AsyncTaskBase<Progress, Result, Params...>::AsyncTaskBase;
+};
+
+
+// AsyncTaskPQ: AsyncTask using Progress Queue to handle progress queue in the proper order and handle every published progress item
+template<typename Progress, typename Result, typename... Params>
+class AsyncTaskPQ : public AsyncTaskPQBase<AsyncTaskProgressQueue<Progress>, Progress, Result, Params...>
+{
+public:
+  using AsyncTaskPQBase<AsyncTaskProgressQueue<Progress>, Progress, Result, Params...>::AsyncTaskPQBase;
+};
+
+
+// AsyncTaskPQRingBuffer: AsyncTaskPQ with bounded, lock-free and allocation-free progress queue
+//  - Capacity: maximal number of the unhandled progress items
+//  - Overflow: behavior if the queue is full (see AsyncTaskOverflowPolicy)
+// Progress must be default constructible. Every item is kept until the next isLastShouldBeAltered() in Coalesce mode.
+template<size_t Capacity, AsyncTaskOverflowPolicy Overflow, typename Progress, typename Result, typename... Params>
+class AsyncTaskPQRingBuffer : public AsyncTaskPQBase<AsyncTaskProgressRingBuffer<Progress, Capacity, Overflow>, Progress, Result, Params...>
+{
+public:
+  using AsyncTaskPQBase<AsyncTaskProgressRingBuffer<Progress, Capacity, Overflow>, Progress, Result, Params...>::AsyncTaskPQBase;
+};
+
+
+// AsyncTaskStreaming: AsyncTaskT (AsyncTask, AsyncTaskPQ, etc.) with a channel of partial results, separated from the progress
+//  - doInBackground() hands over owned chunks of the result by publishPartialResult(), they are moved into the onPartialResult() on the main thread, e.g.: rows of a large output.
+//  - Chunks are handled in the published order, before the progress of the same callback loop, and every remaining one before the onPostExecute(). They are not handled after the cancellation.
+//  - publishPartialResult() is thread-safe, chunks can be published by the parallelFor() bodies too. Chunk must be move constructible (e.g.: std::unique_ptr<Buffer>).
+template<typename Chunk, typename AsyncTaskT>
+class AsyncTaskStreaming : public AsyncTaskT
+{
+private:
+  AsyncTaskProgressQueue<Chunk> mPartialResults{ this->getMemoryResource() };
+
+public:
+  using AsyncTaskT::AsyncTaskT;
+
+  // Hand over a chunk of the result to the main thread without copy
+  // Use inside the doInBackground()
+  // @WorkerThread
+  void publishPartialResult(Chunk&& chunk)
+  {
+    if (this->isCancelled())
+      return;
+
+    this->mPartialResults.store(std::move(chunk), [](Chunk const&, Chunk const&) { return std::optional<Chunk>{}; }, [] { return false; });
+    this->notifyPartialResult();
+  }
+
+protected:
+  // Consume a chunk of the result, it is owned by the handler
+  // @MainThread
+  virtual void onPartialResult(Chunk&&) {}
+
+  size_t handlePartialResults(size_t nMax) override
+  {
+    return this->mPartialResults.consumeBatch([this](Chunk* chunks, size_t size)
+    {
+      for (size_t i = 0; i < size; ++i)
+        this->onPartialResult(std::move(chunks[i]));
+    }, nMax);
+  }
+
+  size_t getPendingPartialResultCount() const override { return this->mPartialResults.size(); }
+
+  // @MainThread
+  void resetProgress() override
+  {
+    AsyncTaskT::resetProgress();
+    this->mPartialResults.reset();
+  }
+};
+
+#endif // !ASYNCTASK_NO_PQ
+
+
+// Budget of a callback loop pass of the AsyncTaskGroup, e.g.: a part of the frame time
+struct AsyncTaskCallbackBudget
+{
+  // Time of the pass, it is checked after every turn
+  std::chrono::steady_clock::duration maxTime = std::chrono::steady_clock::duration::max();
+
+  // Callbacks of the pass: progress items and finishes
+  size_t maxCallbacks = std::numeric_limits<size_t>::max();
+
+  // Callbacks of a member in its turn, then the next member gets its turn
+  size_t maxCallbacksPerTurn = 64;
+};
+
+
+// AsyncTaskGroup: Execute and join many AsyncTasks with one callback loop
+//  - Members are registered by add() before their execute(). The group references them, or owns them if they are added by std::unique_ptr.
+//  - Members notify the group about their progress, cancellation and finish (by their wake-up callback), onCallbackLoop() handles only the updated ones.
+//  - onCallbackLoop(budget) dispatches the callbacks in round-robin turns of the updated members within the budget, the leftover ones are carried over to the next pass.
+//  - onCallbackLoop() and the when*() could rethrow the members' doInBackground() exceptions.
+// Nocopy object. Referenced members must outlive the group, the Dtor cancels and waits for the unfinished members.
+class AsyncTaskGroup
+{
+private:
+  struct Member
   {
-  private:
-    std::queue<Data> mData{};
-    mutable std::mutex mMutex{};
+    void* task = nullptr;
+    bool(*fnCallbackLoop)(void*) = nullptr;
+    bool(*fnDispatch)(void*, size_t&) = nullptr;
+    size_t(*fnPendingCount)(void const*) = nullptr;
+    void(*fnLaunch)(void*) = nullptr;
+    bool(*fnIsRunning)(void*) noexcept = nullptr;
+    void(*fnCancel)(void*) noexcept = nullptr;
+    void(*fnSetAffinity)(void*, AsyncTaskAffinity const&) = nullptr;
+    void(*fnSetWakeUp)(void*, std::function<void()>&&) = nullptr;
+    std::function<void()> fnWakeUpOfTask; // The task's own hook, it is restored by the Dtor of the group
+    bool isFinished = false;
+    bool isScheduled = false; // In the round-robin queue of the budgeted onCallbackLoop()
+  };
 
-  public:
-    ThreadSafeQueue() = default;
-    ThreadSafeQueue(ThreadSafeQueue const&) = delete;
-    ThreadSafeQueue(ThreadSafeQueue&&) = delete;
-    ThreadSafeQueue& operator=(ThreadSafeQueue const&) = delete;
-    ThreadSafeQueue& operator=(ThreadSafeQueue&&) = delete;
+  // Update handling
+  mutable std::mutex mMutex;
+  std::condition_variable mCondition;
+  std::vector<size_t> mMembersUpdated; // Guarded by mMutex
+  std::vector<bool> mMembersIsUpdated; // Guarded by mMutex: a member is in the mMembersUpdated only once
+  std::vector<size_t> mMembersInProcess; // @MainThread
+  std::deque<size_t> mMembersScheduled; // @MainThread: round-robin queue of the budgeted onCallbackLoop()
+  std::function<void()> fnWakeUp;
+  std::atomic_bool isWakeUpSignaled = { false };
+
+  // Members
+  std::vector<Member> mMembers;
+  std::vector<size_t> mMembersFinished; // In the order of the finish
+  size_t mMembersFinishedReported = 0; // Reported by whenAny()
+  std::vector<std::shared_ptr<void>> mMembersOwned; // Destructed first, their workers could notify the group until that.
+  AsyncTaskAffinity mAffinity; // Applied to every member
+
+public:
+  AsyncTaskGroup() = default;
+  AsyncTaskGroup(AsyncTaskGroup const&) = delete;
+  AsyncTaskGroup(AsyncTaskGroup&&) = delete;
+  AsyncTaskGroup& operator=(AsyncTaskGroup const&) = delete;
+  AsyncTaskGroup& operator=(AsyncTaskGroup&&) = delete;
+
+  ~AsyncTaskGroup() noexcept
+  {
+    cancelAll();
+    while (isAnyRunning())
+    {
+      try
+      {
+        if (!onCallbackLoop())
+          waitForUpdate(std::chrono::milliseconds(10));
+      }
+      catch (...)
+      {
+        // Exception rethrow: No, like the AsyncTask's Dtor.
+      }
+    }
+
+    // Referenced members could outlive the group, their next runs must not notify it
+    for (auto& member : mMembers)
+      member.fnSetWakeUp(member.task, std::move(member.fnWakeUpOfTask));
+  }
+
+  // Register a task as referenced member, the task should be PENDING
+  // The group chains its notification to the task's wake-up callback: the task's own hook is still invoked. The hook should be set before add(), a later setWakeUpCallback() replaces the chained one.
+  // The Dtor of the group restores the task's own hook, the task could be run again after that.
+  // @MainThread
+  template<typename Task>
+  Task& add(Task& task) noexcept(false)
+  {
+    switch (task.getStatus())
+    {
+      case Task::Status::PENDING: break; // Everything is ok.
+      case Task::Status::RUNNING: throw AsyncTaskIllegalStateException(AsyncTaskIllegalStateException::eEx::TaskIsAlreadyRunning);
+      case Task::Status::FINISHED: throw AsyncTaskIllegalStateException(AsyncTaskIllegalStateException::eEx::TaskIsAlreadyFinished);
+    }
 
-    template<typename BinaryAlteration>
-    void store(Data const& data, BinaryAlteration fnLastShouldBeAltered)
+    auto const index = mMembers.size();
     {
       std::unique_lock<std::mutex> lock(mMutex);
-      if (!mData.empty())
+      mMembersUpdated.reserve(index + 1);
+      mMembersIsUpdated.push_back(false);
+    }
+    mMembersInProcess.reserve(index + 1);
+    mMembersFinished.reserve(index + 1);
+
+    mMembers.push_back(Member{ &task
+      , [](void* task) { return static_cast<Task*>(task)->onCallbackLoop(); }
+      , [](void* task, size_t& nCallbackBudget) { return static_cast<Task*>(task)->dispatchCallbacks(nCallbackBudget); }
+      , [](void const* task) { return static_cast<Task const*>(task)->getPendingCallbackCount(); }
+      , [](void* task) { static_cast<Task*>(task)->launch(); }
+      , [](void* task) noexcept { return static_cast<Task*>(task)->getStatus() == Task::Status::RUNNING; }
+      , [](void* task) noexcept { static_cast<Task*>(task)->cancel(); }
+      , [](void* task, AsyncTaskAffinity const& affinity) { static_cast<Task*>(task)->setAffinity(affinity); }
+      , [](void* task, std::function<void()>&& fnWakeUp) { static_cast<Task*>(task)->setWakeUpCallback(std::move(fnWakeUp)); }
+      , task.getWakeUpCallback()
+    });
+    task.setWakeUpCallback([this, index, fnWakeUpOfTask = task.getWakeUpCallback()] {
+      this->notifyUpdate(index);
+      if (fnWakeUpOfTask)
+        fnWakeUpOfTask();
+    });
+    if (!mAffinity.isAny())
+      task.setAffinity(mAffinity);
+    return task;
+  }
+
+  // Register a task as owned member, the task should be PENDING
+  // @MainThread
+  template<typename Task>
+  Task& add(std::unique_ptr<Task>&& task) noexcept(false)
+  {
+    auto& taskAdded = add(*task);
+    mMembersOwned.emplace_back(std::move(task));
+    return taskAdded;
+  }
+
+  // @MainThread
+  size_t size() const noexcept { return mMembers.size(); }
+
+  // @MainThread
+  size_t getFinishedCount() const noexcept { return mMembersFinished.size(); }
+
+  // @MainThread
+  bool isAllFinished() const noexcept { return getFinishedCount() == size(); }
+
+  // Cancel every member
+  // @MainThread
+  void cancelAll() noexcept
+  {
+    for (auto const& member : mMembers)
+      if (!member.isFinished)
+        member.fnCancel(member.task);
+  }
+
+  // Set the worker placement hint of the current and the later added members (see AsyncTaskBase::setAffinity()).
+  // E.g.: AsyncTaskAffinity{ AsyncTaskAffinity::anyNode, { core }, true } pins every member to one worker of an AsyncTaskThreadPool, they run one after another there.
+  // If a member is already running, AsyncTaskIllegalStateException will be thrown
+  // @MainThread, before the members' execute()
+  void setAffinity(AsyncTaskAffinity affinity) noexcept(false)
+  {
+    mAffinity = std::move(affinity);
+    for (auto const& member : mMembers)
+      member.fnSetAffinity(member.task, mAffinity);
+  }
+
+  // Set the optional wake-up hook of the main thread, it is invoked if any member is updated, but only once until the next onCallbackLoop().
+  // The hook is invoked on the worker thread, it must be thread-safe and it must not throw.
+  // @MainThread, before the members' execute()
+  void setWakeUpCallback(std::function<void()> fnWakeUp) { this->fnWakeUp = std::move(fnWakeUp); }
+
+  // Callback loop of the updated members in one pass
+  // Return true if every member is finished. Exception from the members' doInBackground can be rethrown.
+  // @MainThread
+  bool onCallbackLoop()
+  {
+    isWakeUpSignaled.store(false);
+    takeUpdated();
+
+    // Leftovers of the budgeted onCallbackLoop() are drained without limit: their progress items are still handled before the finish
+    for (auto const index : mMembersScheduled)
+      if (std::find(mMembersInProcess.begin(), mMembersInProcess.end(), index) == mMembersInProcess.end())
+        mMembersInProcess.push_back(index);
+    mMembersScheduled.clear();
+
+    for (size_t i = 0; i < mMembersInProcess.size(); ++i)
+    {
+      auto const index = mMembersInProcess[i];
+      auto& member = mMembers[index];
+      if (member.isFinished)
+        continue;
+
+      try
       {
-        auto const oData = fnLastShouldBeAltered(mData.back(), data);
-        if (oData.has_value())
+        auto nCallbackBudget = std::numeric_limits<size_t>::max();
+        if (std::exchange(member.isScheduled, false) ? member.fnDispatch(member.task, nCallbackBudget) : member.fnCallbackLoop(member.task))
+          setFinished(index);
+      }
+      catch (...)
+      {
+        auto const iNext = member.fnIsRunning(member.task) ? i : i + 1;
+        if (iNext == i + 1)
+          setFinished(index);
+
+        // Unprocessed ones are kept for the next onCallbackLoop()
         {
-          mData.back() = oData.value();
-          return;
+          std::unique_lock<std::mutex> lock(mMutex);
+          for (auto it = mMembersInProcess.begin() + iNext; it != mMembersInProcess.end(); ++it)
+            if (mMembers[*it].isScheduled)
+              mMembersScheduled.push_back(*it);
+            else if (!mMembersIsUpdated[*it])
+            {
+              mMembersIsUpdated[*it] = true;
+              mMembersUpdated.push_back(*it);
+            }
         }
+        mMembersInProcess.clear();
+        throw;
+      }
+    }
+    mMembersInProcess.clear();
+
+    return isAllFinished();
+  }
+
+  // Callback loop of the updated members within the budget: members get turns in round-robin order, the leftover callbacks are carried over to the next call.
+  // Pending progress items of a member are handled before its onPostExecute().
+  // Return true if every member is finished. Exception from the members' doInBackground can be rethrown.
+  // @MainThread
+  bool onCallbackLoop(AsyncTaskCallbackBudget const& budget)
+  {
+    isWakeUpSignaled.store(false);
+    takeUpdated();
+    for (auto const index : mMembersInProcess)
+      schedule(index);
+    mMembersInProcess.clear();
+
+    auto const isTimed = budget.maxTime != std::chrono::steady_clock::duration::max();
+    auto const deadline = isTimed ? std::chrono::steady_clock::now() + budget.maxTime : std::chrono::steady_clock::time_point::max();
+    auto nCallbackBudget = budget.maxCallbacks;
+    while (!mMembersScheduled.empty() && nCallbackBudget > 0)
+    {
+      auto const index = mMembersScheduled.front();
+      mMembersScheduled.pop_front();
+      auto& member = mMembers[index];
+      member.isScheduled = false;
+      if (member.isFinished)
+        continue;
+
+      auto nTurnBudget = std::min(nCallbackBudget, std::max<size_t>(1, budget.maxCallbacksPerTurn));
+      auto const nTurnBudgetBegin = nTurnBudget;
+      try
+      {
+        if (member.fnDispatch(member.task, nTurnBudget))
+          setFinished(index);
+        else if (member.fnPendingCount(member.task) > 0)
+          schedule(index);
+      }
+      catch (...)
+      {
+        if (member.fnIsRunning(member.task))
+          schedule(index);
+        else
+          setFinished(index);
+
+        throw;
       }
+      nCallbackBudget -= nTurnBudgetBegin - nTurnBudget;
+
+      if (isTimed && std::chrono::steady_clock::now() >= deadline)
+        break;
+    }
+
+    return isAllFinished();
+  }
+
+  // Number of the callbacks which are waiting for the callback loop: unhandled progress items and finishes of the members
+  // @MainThread
+  size_t getPendingCount() const
+  {
+    size_t nPending = 0;
+    for (auto const& member : mMembers)
+      if (!member.isFinished)
+        nPending += member.fnPendingCount(member.task);
+
+    return nPending;
+  }
+
+  // Block the main thread until any member is updated or the timeout is expired. Return true if there is any updated member.
+  // @MainThread
+  template<typename Rep, typename Period>
+  bool waitForUpdate(std::chrono::duration<Rep, Period> const& timeout)
+  {
+    if (!mMembersScheduled.empty())
+      return true; // Leftover of the budgeted onCallbackLoop()
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    return mCondition.wait_for(lock, timeout, [this] { return !mMembersUpdated.empty(); });
+  }
+
+  // Callback loop of the updated members after waiting for an update at most maxWait, it returns right away if an update is already there.
+  // Return true if every member is finished. Exception from the members' doInBackground can be rethrown.
+  // @MainThread
+  template<typename Rep, typename Period>
+  bool onCallbackLoop(std::chrono::duration<Rep, Period> const& maxWait)
+  {
+    if (!isAllFinished())
+      waitForUpdate(maxWait);
+
+    return onCallbackLoop();
+  }
+
+  // Launch the Deferred members (see AsyncTaskLaunchPolicy), the when*() launch them too
+  // @MainThread
+  void launchAll() noexcept(false)
+  {
+    for (auto const& member : mMembers)
+      if (!member.isFinished)
+        member.fnLaunch(member.task);
+  }
+
+  // Drive the callback loop until every member is finished.
+  // @MainThread
+  void whenAll()
+  {
+    launchAll();
+    while (!onCallbackLoop())
+      waitForUpdate(std::chrono::milliseconds(100));
+  }
+
+  // Drive the callback loop until every member is finished or the timeout is expired. Return true if every member is finished.
+  // @MainThread
+  template<typename Rep, typename Period>
+  bool whenAll(std::chrono::duration<Rep, Period> const& timeout)
+  {
+    launchAll();
+    auto const deadline = std::chrono::steady_clock::now() + timeout;
+    while (!onCallbackLoop())
+      if (!waitForUpdateUntil(deadline))
+        return onCallbackLoop();
+
+    return true;
+  }
+
+  // Drive the callback loop until a member is finished, which was not returned by the earlier whenAny(). Return its index in the order of add().
+  // std::nullopt is returned if every finished member is already reported.
+  // @MainThread
+  std::optional<size_t> whenAny()
+  {
+    launchAll();
+    while (mMembersFinishedReported == getFinishedCount() && !isAllFinished())
+      if (!onCallbackLoop())
+        waitForUpdate(std::chrono::milliseconds(100));
+
+    return popFinished();
+  }
+
+  // Like whenAny(), std::nullopt is returned if the timeout is expired.
+  // @MainThread
+  template<typename Rep, typename Period>
+  std::optional<size_t> whenAny(std::chrono::duration<Rep, Period> const& timeout)
+  {
+    launchAll();
+    auto const deadline = std::chrono::steady_clock::now() + timeout;
+    while (mMembersFinishedReported == getFinishedCount() && !isAllFinished())
+    {
+      if (onCallbackLoop())
+        break;
 
-      mData.push(data);
+      if (!waitForUpdateUntil(deadline))
+      {
+        onCallbackLoop();
+        break;
+      }
     }
 
+    return popFinished();
+  }
 
-    std::queue<Data> move()
+private:
+  // @WorkerThread
+  void notifyUpdate(size_t index) noexcept
+  {
     {
       std::unique_lock<std::mutex> lock(mMutex);
-      auto const mDataMoved = std::move(mData);
-      return mDataMoved;
+      if (mMembersIsUpdated[index])
+        return;
+
+      mMembersIsUpdated[index] = true;
+      mMembersUpdated.push_back(index); // Capacity is reserved: a member is in the list only once
     }
-  };
+    mCondition.notify_all();
 
-  ThreadSafeQueue<Progress> mProgressQueue;
+    if (fnWakeUp && !isWakeUpSignaled.exchange(true))
+      fnWakeUp();
+  }
 
-protected:
+  template<typename Clock, typename Duration>
+  bool waitForUpdateUntil(std::chrono::time_point<Clock, Duration> const& deadline)
+  {
+    if (!mMembersScheduled.empty())
+      return true;
 
-  // To define condition when not all progress item wanted to be stored. It will be used in thread-safe environment.
-  // @WorkerThread 
-  virtual std::optional<Progress> isLastShouldBeAltered(Progress const& progressOld, Progress const& progressNew) const { return std::nullopt; }
+    std::unique_lock<std::mutex> lock(mMutex);
+    return mCondition.wait_until(lock, deadline, [this] { return !mMembersUpdated.empty(); });
+  }
+
+  // Move the updated members into the mMembersInProcess
+  // @MainThread
+  void takeUpdated()
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    std::swap(mMembersUpdated, mMembersInProcess);
+    for (auto const index : mMembersInProcess)
+      mMembersIsUpdated[index] = false;
+  }
+
+  // @MainThread
+  void schedule(size_t index)
+  {
+    if (std::exchange(mMembers[index].isScheduled, true))
+      return;
+
+    mMembersScheduled.push_back(index);
+  }
+
+  bool isAnyRunning() const noexcept
+  {
+    return std::any_of(mMembers.begin(), mMembers.end(), [](auto const& member) { return !member.isFinished && member.fnIsRunning(member.task); });
+  }
+
+  void setFinished(size_t index) noexcept
+  {
+    mMembers[index].isFinished = true;
+    mMembersFinished.push_back(index);
+  }
+
+  std::optional<size_t> popFinished() noexcept
+  {
+    if (mMembersFinishedReported == getFinishedCount())
+      return std::nullopt;
+
+    return mMembersFinished[mMembersFinishedReported++];
+  }
+};
+
+
+#if defined(__cpp_lib_coroutine) && !defined(ASYNCTASK_NO_COROUTINE)
+
+// AsyncTaskAwaiter: co_await support of the AsyncTasks
+//  - The awaiting coroutine is resumed by the task's executor when the task is finished, no polling and blocking wait is needed.
+//  - The resumed coroutine takes the main thread's role: onPostExecute()/onCancelled() is invoked there, and the exception of the doInBackground() is rethrown.
+//  - co_await on a lvalue task returns the const reference of the result, on a rvalue task the result is moved out (takeResult()).
+// The awaited task must be executed (or chained) and it must outlive the suspended coroutine.
+template<bool isResultMoved, typename Progress, typename Result, typename... Params>
+class AsyncTaskAwaiter final : public AsyncTaskJob
+{
+private:
+  AsyncTaskBase<Progress, Result, Params...>& mTask;
+  std::coroutine_handle<> mHandle;
+
+public:
+  explicit AsyncTaskAwaiter(AsyncTaskBase<Progress, Result, Params...>& task) noexcept : mTask(task) {}
+
+  bool await_ready() const noexcept { return mTask.getStatus() == AsyncTaskBase<Progress, Result, Params...>::Status::FINISHED; }
+
+  bool await_suspend(std::coroutine_handle<> handle) noexcept(false)
+  {
+    mHandle = handle;
+    mTask.launch(); // Deferred task is demanded; before the submitOnFinish(), a synchronous or failed launch must not resume the coroutine in here
+    return mTask.submitOnFinish(*this);
+  }
+
+  decltype(auto) await_resume()
+  {
+    if constexpr (isResultMoved)
+      return mTask.takeResult();
+    else
+      return mTask.get();
+  }
 
-  // Store the current state of the progress inside the class
   // @WorkerThread
-  void storeProgress(Progress const& progress) override
+  void run() noexcept override { mHandle.resume(); }
+};
+
+template<typename Progress, typename Result, typename... Params>
+AsyncTaskAwaiter<false, Progress, Result, Params...> operator co_await(AsyncTaskBase<Progress, Result, Params...>& task) noexcept
+{
+  return AsyncTaskAwaiter<false, Progress, Result, Params...>(task);
+}
+
+template<typename Progress, typename Result, typename... Params>
+AsyncTaskAwaiter<true, Progress, Result, Params...> operator co_await(AsyncTaskBase<Progress, Result, Params...>&& task) noexcept
+{
+  return AsyncTaskAwaiter<true, Progress, Result, Params...>(task);
+}
+
+
+// AsyncTaskCoroutine: Return type of the AsyncTaskCo::doInBackgroundCo()
+//  - co_yield publishes the progress, co_return gives the result.
+//  - It is started lazily by the first step of the task.
+template<typename Progress, typename Result>
+class AsyncTaskCoroutine
+{
+public:
+  struct promise_type
   {
-    // or use overrideLast() in special cases.
-    this->mProgressQueue.store(progress, [this](Progress const& progressOld, Progress const& progressNew)
+    Progress const* progress = nullptr;
+    Progress* progressMovable = nullptr;
+    std::optional<Result> result;
+    std::exception_ptr eptr;
+
+    AsyncTaskCoroutine get_return_object() noexcept { return AsyncTaskCoroutine(std::coroutine_handle<promise_type>::from_promise(*this)); }
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    std::suspend_always final_suspend() const noexcept { return {}; }
+    void unhandled_exception() noexcept { eptr = std::current_exception(); }
+
+    template<typename ResultT>
+    void return_value(ResultT&& result) { this->result.emplace(std::forward<ResultT>(result)); }
+
+    std::suspend_always yield_value(Progress const& progress) noexcept
     {
-      return this->isLastShouldBeAltered(progressOld, progressNew);
-    });
+      this->progress = &progress;
+      this->progressMovable = nullptr;
+      return {};
+    }
+
+    std::suspend_always yield_value(Progress&& progress) noexcept
+    {
+      this->progress = &progress;
+      this->progressMovable = &progress;
+      return {};
+    }
+  };
+
+private:
+  std::coroutine_handle<promise_type> mHandle;
+
+  explicit AsyncTaskCoroutine(std::coroutine_handle<promise_type> handle) noexcept : mHandle(handle) {}
+
+public:
+  AsyncTaskCoroutine() noexcept = default;
+  AsyncTaskCoroutine(AsyncTaskCoroutine const&) = delete;
+  AsyncTaskCoroutine(AsyncTaskCoroutine&& other) noexcept : mHandle(std::exchange(other.mHandle, nullptr)) {}
+  AsyncTaskCoroutine& operator=(AsyncTaskCoroutine const&) = delete;
+  AsyncTaskCoroutine& operator=(AsyncTaskCoroutine&& other) noexcept
+  {
+    if (this != &other)
+    {
+      if (mHandle)
+        mHandle.destroy();
+
+      mHandle = std::exchange(other.mHandle, nullptr);
+    }
+    return *this;
   }
 
-  // Show progress in the feedback system
-  // @MainThread
-  virtual void onProgressUpdate(Progress const&) {}
+  ~AsyncTaskCoroutine() noexcept
+  {
+    if (mHandle)
+      mHandle.destroy();
+  }
+
+  explicit operator bool() const noexcept { return static_cast<bool>(mHandle); }
+  bool isDone() const noexcept { return !mHandle || mHandle.done(); }
+  promise_type& getPromise() const noexcept { return mHandle.promise(); }
+
+  // Run until the next co_yield or co_return
+  void resume() const { mHandle.resume(); }
+};
+
+
+// AsyncTaskCo: AsyncTask with coroutine based doInBackground
+//  - The worker task should be defined in the doInBackgroundCo(), co_yield feeds the publishProgress().
+//  - Every co_yield is a cancellation check: the coroutine is not resumed after cancel().
+//  - Every co_yield is a suspension point: if the executor has other pending jobs (e.g.: AsyncTaskThreadPool), the task gives its worker to them, one worker can multiplex many tasks.
+template<typename Progress, typename Result, typename... Params>
+class AsyncTaskCo : public AsyncTask<Progress, Result, Params...>
+{
+public:
+  using Coroutine = AsyncTaskCoroutine<Progress, Result>;
+
+private:
+  Coroutine mCoroutine; // @WorkerThread
+  std::exception_ptr eptrStep; // @WorkerThread
+
+public:
+  // Same constructors as the AsyncTask's
+  template<typename... Args>
+  explicit AsyncTaskCo(Args&&... args) : AsyncTask<Progress, Result, Params...>(std::forward<Args>(args)...)
+  {
+    this->isStepwise = true;
+  }
+
+  ~AsyncTaskCo() noexcept override
+  {
+    this->cancelAndWait(); // The coroutine frame must not be destroyed during its step
+  }
 
 protected:
-  virtual void handleProgress() override final
+  // Coroutine based background worker task
+  // Exception can be thrown, it will be rethrown in get(), onCallbackLoop() or Dtor()
+  // @WorkerThread
+  virtual Coroutine doInBackgroundCo(Params const&... params) = 0;
+
+  // The coroutine of the earlier run is dropped too
+  // @MainThread
+  void resetProgress() override
   {
-    for (auto progressQueue = mProgressQueue.move(); !progressQueue.empty(); progressQueue.pop())
-      this->onProgressUpdate(progressQueue.front());
+    AsyncTask<Progress, Result, Params...>::resetProgress();
+    mCoroutine = {};
+    eptrStep = nullptr;
   }
 
-public:
-  using AsyncTaskBase<Progress, Result, Params...>::AsyncTaskBase;
+private:
+  // @WorkerThread
+  bool stepInBackground(Params const&... params) noexcept final
+  {
+    try
+    {
+      if (!mCoroutine)
+        mCoroutine = doInBackgroundCo(params...);
+
+      mCoroutine.resume();
+      if (mCoroutine.isDone())
+        return true;
+
+      auto& promise = mCoroutine.getPromise();
+      if (promise.progressMovable)
+        this->publishProgress(std::move(*promise.progressMovable));
+      else
+        this->publishProgress(*promise.progress);
+
+      return false;
+    }
+    catch (...)
+    {
+      eptrStep = std::current_exception();
+      return true;
+    }
+  }
+
+  // @WorkerThread
+  Result doInBackground(Params const&...) final
+  {
+    if (eptrStep)
+      std::rethrow_exception(eptrStep);
+
+    auto& promise = mCoroutine.getPromise();
+    if (promise.eptr)
+      std::rethrow_exception(promise.eptr);
+
+    return std::move(*promise.result);
+  }
 };
+
+#endif // __cpp_lib_coroutine
+
+
+// Explicit instantiation of the AsyncTasks by Progress, Result and Params..., to compile them only once in a project
+//  - ASYNCTASK_EXTERN_TEMPLATES(Progress, Result, Params...) in a shared header: the including translation units do not instantiate them.
+//  - ASYNCTASK_INSTANTIATE_TEMPLATES(Progress, Result, Params...) in exactly one translation unit (like asynctask.cpp for the ASYNCTASK_COMMON_TEMPLATES).
+#ifdef ASYNCTASK_NO_PQ
+#define ASYNCTASK_EXPLICIT_PQ_TEMPLATES(prefix, ...)
+#else
+#define ASYNCTASK_EXPLICIT_PQ_TEMPLATES(prefix, ...) \
+  prefix template class AsyncTaskPQBase<AsyncTaskProgressQueue<ASYNCTASK_FIRST_(__VA_ARGS__)>, __VA_ARGS__>; \
+  prefix template class AsyncTaskPQ<__VA_ARGS__>;
+#endif
+
+#define ASYNCTASK_FIRST_(first, ...) first
+#define ASYNCTASK_EXPLICIT_TEMPLATES_(prefix, ...) \
+  prefix template class AsyncTaskBase<__VA_ARGS__>; \
+  prefix template class AsyncTask<__VA_ARGS__>; \
+  ASYNCTASK_EXPLICIT_PQ_TEMPLATES(prefix, __VA_ARGS__)
+
+#define ASYNCTASK_EXTERN_TEMPLATES(...) ASYNCTASK_EXPLICIT_TEMPLATES_(extern, __VA_ARGS__)
+#define ASYNCTASK_INSTANTIATE_TEMPLATES(...) ASYNCTASK_EXPLICIT_TEMPLATES_(, __VA_ARGS__)
+
+// Common Progress, Result and Params combinations of the asynctask.cpp
+#define ASYNCTASK_COMMON_TEMPLATES(X) \
+  X(int, int, int) \
+  X(int, double, int) \
+  X(double, int, int) \
+  X(double, double, double)
+
+#ifdef ASYNCTASK_EXTERN_COMMON_TEMPLATES
+ASYNCTASK_COMMON_TEMPLATES(ASYNCTASK_EXTERN_TEMPLATES)
+#endif
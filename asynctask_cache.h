@@ -0,0 +1,232 @@
+/*
+MIT License
+
+Copyright (c) 2020 Attila Csikós (attcs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+// Result cache of the tasks (see AsyncTaskBase::setResultCache()). It is separated from the asynctask.h: only its users pay for the <list> and the <unordered_map>.
+
+#include "asynctask.h"
+
+#include <list>
+#include <unordered_map>
+#include <stdexcept>
+
+
+// Result cache of the AsyncTasks, keyed by the Params (see AsyncTaskBase::setResultCache())
+//  - execute() of a cached Params completes the task without the worker, the Result is copied from the cache.
+//  - Tasks with the same Params in flight share one computation: the first one computes, the others wait for its Result. If it is cancelled or it throws, the next waiting one takes over.
+//  - Least recently used Results are evicted above the limits of the entries and the bytes (measured by fnSizeOf, sizeof(Result) by default).
+//  - Params must be equality comparable, they are hashed by fnHash (std::hash of every param by default). Without std::hash, fnHash must be given.
+// Thread-safe, one cache can be shared by many tasks and main threads. It must outlive its tasks.
+template<typename Result, typename... Params>
+class AsyncTaskResultCache final : public AsyncTaskResultCacheBase<Result, Params...>
+{
+public:
+  using Key = typename AsyncTaskResultCacheBase<Result, Params...>::Key;
+  using Acquisition = typename AsyncTaskResultCacheBase<Result, Params...>::Acquisition;
+  using Waiter = typename AsyncTaskResultCacheBase<Result, Params...>::Waiter;
+
+private:
+  struct KeyHash
+  {
+    size_t(*fnHash)(Params const&...) = nullptr;
+    size_t operator()(Key const& key) const { return std::apply(fnHash, key); }
+  };
+
+  struct Entry
+  {
+    std::optional<Result> result; // In flight if it is empty
+    size_t nBytes = 0;
+    std::vector<Waiter> waiters;
+    typename std::list<Key const*>::iterator itLru{};
+  };
+
+  size_t mMaxEntries;
+  size_t mMaxBytes;
+  size_t(*fnSizeOf)(Result const&);
+
+  mutable std::mutex mMutex;
+  std::unordered_map<Key, Entry, KeyHash> mEntries; // Guarded by mMutex
+  std::list<Key const*> mLru; // Guarded by mMutex: keys of the cached Results, the most recently used is the first
+  size_t mBytes = 0; // Guarded by mMutex
+
+public:
+  static bool constexpr isParamsHashable = (std::is_default_constructible_v<std::hash<Params>> && ...);
+
+  // Params are hashed by std::hash, it does not compile if any of them has no std::hash
+  template<bool isHashable = isParamsHashable>
+  explicit AsyncTaskResultCache(size_t maxEntries, size_t maxBytes = std::numeric_limits<size_t>::max(), size_t(*fnSizeOf)(Result const&) = nullptr)
+    : AsyncTaskResultCache(maxEntries, maxBytes, fnSizeOf, nullptr)
+  {
+    static_assert(isHashable, "AsyncTaskResultCache needs fnHash for Params without std::hash.");
+  }
+
+  // Params are hashed by fnHash, std::hash is used if it is nullptr. If any Param has no std::hash, nullptr fnHash throws std::invalid_argument.
+  AsyncTaskResultCache(size_t maxEntries, size_t maxBytes, size_t(*fnSizeOf)(Result const&), size_t(*fnHash)(Params const&...)) noexcept(false)
+    : mMaxEntries(maxEntries)
+    , mMaxBytes(maxBytes)
+    , fnSizeOf(fnSizeOf ? fnSizeOf : +[](Result const&) { return sizeof(Result); })
+    , mEntries(0, KeyHash{ fnHash ? fnHash : getHashDefault() })
+  {}
+
+  AsyncTaskResultCache(AsyncTaskResultCache const&) = delete;
+  AsyncTaskResultCache& operator=(AsyncTaskResultCache const&) = delete;
+  ~AsyncTaskResultCache() override = default;
+
+  // Number of the cached Results
+  size_t size() const
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    return mLru.size();
+  }
+
+  // Drop the cached Results, the in-flight computations are kept
+  void clear()
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (!mLru.empty())
+      evictLocked();
+  }
+
+  // Look up the key: copy the cached Result into the resultHit, or register the waiter, or expect the computation from the caller
+  Acquisition acquire(Key const& key, Waiter const& waiter, std::optional<Result>& resultHit) noexcept(false) override
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    auto const [it, isInserted] = mEntries.try_emplace(key);
+    if (isInserted)
+      return Acquisition::Lead;
+
+    auto& entry = it->second;
+    if (!entry.result)
+    {
+      entry.waiters.push_back(waiter);
+      return Acquisition::Wait;
+    }
+
+    resultHit.emplace(*entry.result);
+    mLru.splice(mLru.begin(), mLru, entry.itLru);
+    return Acquisition::Hit;
+  }
+
+  // The computation of the key is finished: the Result is cached and the waiters are resumed with it
+  // If the Result could not be copied into the cache, the waiters are resumed as by abandon().
+  void complete(Key const& key, Result const& result) noexcept override
+  {
+    auto waiters = std::vector<Waiter>{};
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      auto const it = mEntries.find(key);
+      if (it == mEntries.end())
+        return;
+
+      try
+      {
+        auto& entry = it->second;
+        entry.result.emplace(result);
+        entry.nBytes = fnSizeOf(result);
+        entry.itLru = mLru.insert(mLru.begin(), &it->first);
+        waiters = std::move(entry.waiters);
+        mBytes += entry.nBytes;
+      }
+      catch (...)
+      {
+        it->second.result.reset();
+        lock.unlock();
+        return abandon(key);
+      }
+
+      while (!mLru.empty() && (mLru.size() > mMaxEntries || mBytes > mMaxBytes))
+        evictLocked();
+    }
+
+    for (auto const& waiter : waiters)
+      waiter.fnResume(waiter.task, &result);
+  }
+
+  // The computation of the key is cancelled or failed: the first waiter takes over it, the key is dropped if there is no waiter
+  void abandon(Key const& key) noexcept override
+  {
+    auto waiter = Waiter{};
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      auto const it = mEntries.find(key);
+      if (it == mEntries.end() || it->second.result)
+        return;
+
+      auto& waiters = it->second.waiters;
+      if (waiters.empty())
+      {
+        mEntries.erase(it);
+        return;
+      }
+
+      waiter = waiters.front();
+      waiters.erase(waiters.begin());
+    }
+
+    waiter.fnResume(waiter.task, nullptr);
+  }
+
+  // Unregister the waiter (e.g.: it is cancelled), return false if it is already resumed
+  bool detach(Key const& key, void const* task) noexcept override
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    auto const it = mEntries.find(key);
+    if (it == mEntries.end())
+      return false;
+
+    auto& waiters = it->second.waiters;
+    auto const itWaiter = std::find_if(waiters.begin(), waiters.end(), [task](Waiter const& waiter) { return waiter.task == task; });
+    if (itWaiter == waiters.end())
+      return false;
+
+    waiters.erase(itWaiter);
+    return true;
+  }
+
+private:
+  template<bool isHashable = isParamsHashable> // Not instantiated for the Params without std::hash
+  static size_t hashDefault(Params const&... params) noexcept
+  {
+    auto hash = size_t(0);
+    ((hash ^= std::hash<Params>{}(params) + 0x9e3779b9 + (hash << 6) + (hash >> 2)), ...);
+    return hash;
+  }
+
+  static auto getHashDefault() noexcept(false) -> size_t(*)(Params const&...)
+  {
+    if constexpr (isParamsHashable)
+      return &hashDefault<>;
+    else
+      throw std::invalid_argument("AsyncTaskResultCache needs fnHash for Params without std::hash.");
+  }
+
+  void evictLocked() noexcept
+  {
+    auto const it = mEntries.find(*mLru.back());
+    mLru.pop_back();
+    mBytes -= it->second.nBytes;
+    mEntries.erase(it);
+  }
+};
@@ -0,0 +1,96 @@
+/*
+MIT License
+
+Copyright (c) 2020 Attila Csikós (attcs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+// Forward declarations of the asynctask.h, e.g.: for the headers which only refer to the tasks by pointer or by reference.
+// The compile-time switches (ASYNCTASK_NO_PQ, etc.) are described in asynctask.h.
+
+#include <cstddef>
+
+class AsyncTaskIllegalStateException;
+
+enum class AsyncTaskPriority : int;
+enum class AsyncTaskLaunchPolicy : int;
+enum class AsyncTaskProgressStorage : int;
+
+struct AsyncTaskAffinity;
+struct AsyncTaskLaunchOptions;
+template<typename Progress>
+struct AsyncTaskProgressThrottle;
+struct AsyncTaskProgressReduction;
+struct AsyncTaskCallbackBudget;
+struct AsyncTaskStats;
+struct AsyncTaskWorkerLayout;
+struct AsyncTaskNumaTopology;
+
+class AsyncTaskJob;
+class AsyncTaskExecutor;
+class AsyncTaskThreadExecutor;
+class AsyncTaskThreadPool;
+
+class AsyncTaskCancellationState;
+class AsyncTaskCancellationToken;
+template<typename Callback>
+class AsyncTaskCancelCallback;
+
+class AsyncTaskTraceSink;
+class AsyncTaskChromeTraceSink;
+
+template<typename Result, typename... Params>
+class AsyncTaskResultCacheBase;
+template<typename Result, typename... Params>
+class AsyncTaskResultCache;
+
+template<typename Progress>
+class AsyncTaskProgressBroadcast;
+
+template<typename Progress, typename Result, typename... Params>
+class AsyncTaskBase;
+
+template<typename Progress, typename Result, typename... Params>
+class AsyncTask;
+
+template<typename Progress, typename Result, typename... Params>
+class AsyncTaskStatic;
+
+#ifndef ASYNCTASK_NO_PQ
+enum class AsyncTaskOverflowPolicy : int;
+
+template<typename Progress, typename Result, typename... Params>
+class AsyncTaskPQ;
+
+template<size_t Capacity, AsyncTaskOverflowPolicy Overflow, typename Progress, typename Result, typename... Params>
+class AsyncTaskPQRingBuffer;
+
+template<typename Chunk, typename AsyncTaskT>
+class AsyncTaskStreaming;
+#endif // !ASYNCTASK_NO_PQ
+
+class AsyncTaskGroup;
+
+#ifndef ASYNCTASK_NO_COROUTINE
+template<typename Progress, typename Result, typename... Params>
+class AsyncTaskCo;
+#endif // !ASYNCTASK_NO_COROUTINE
@@ -0,0 +1,128 @@
+/*
+MIT License
+
+Copyright (c) 2020 Attila Csikós (attcs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+// NUMA detection and thread pinning of the AsyncTaskThreadPool's workers. It is separated from the asynctask.h: only its users pay for the platform headers.
+
+#include "asynctask.h"
+
+#include <algorithm>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#include <pthread.h>
+#include <cstdio>
+#endif
+
+
+// AsyncTaskNumaTopology: Worker layout of the machine's NUMA nodes for the AsyncTaskThreadPool, e.g.: AsyncTaskThreadPool(AsyncTaskNumaTopology::detect())
+struct AsyncTaskNumaTopology
+{
+  // Pinned workers on the NUMA nodes and on the cores which are available for the process (Linux: /sys/devices/system/node and the affinity mask of the process).
+  // On other platforms it is AsyncTaskWorkerLayout::uniform(hardware_concurrency) with pinCurrentThread.
+  static AsyncTaskWorkerLayout detect()
+  {
+    auto layout = AsyncTaskWorkerLayout{};
+#ifdef __linux__
+    auto cpuset = cpu_set_t{};
+    auto const isMaskAvailable = sched_getaffinity(0, sizeof(cpuset), &cpuset) == 0;
+    auto const isAvailable = [&](size_t core) { return !isMaskAvailable || (core < CPU_SETSIZE && CPU_ISSET(core, &cpuset)); };
+
+    for (size_t iNode = 0;; ++iNode)
+    {
+      char path[64];
+      std::snprintf(path, sizeof(path), "/sys/devices/system/node/node%zu/cpulist", iNode);
+      auto const file = std::fopen(path, "r");
+      if (!file)
+        break;
+
+      auto cores = std::vector<size_t>{};
+      for (auto const core : parseCpuList(file))
+        if (isAvailable(core))
+          cores.push_back(core);
+
+      std::fclose(file);
+      layout.nodes.push_back(std::move(cores));
+    }
+
+    if (std::all_of(layout.nodes.begin(), layout.nodes.end(), [](auto const& cores) { return cores.empty(); }))
+    {
+      layout.nodes.assign(1, {});
+      for (size_t core = 0; core < CPU_SETSIZE; ++core)
+        if (isMaskAvailable && CPU_ISSET(core, &cpuset))
+          layout.nodes[0].push_back(core);
+    }
+#endif
+    if (std::all_of(layout.nodes.begin(), layout.nodes.end(), [](auto const& cores) { return cores.empty(); }))
+      layout = AsyncTaskWorkerLayout::uniform(std::max<size_t>(1, std::thread::hardware_concurrency()));
+
+    layout.fnPin = &pinCurrentThread;
+    return layout;
+  }
+
+  // Pin the calling thread to the core, it is no-op if it is not supported
+  static void pinCurrentThread([[maybe_unused]] size_t core) noexcept
+  {
+#ifdef __linux__
+    if (core >= CPU_SETSIZE)
+      return;
+
+    auto cpuset = cpu_set_t{};
+    CPU_ZERO(&cpuset);
+    CPU_SET(core, &cpuset);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset); // Failure is ignored, the worker runs unpinned
+#endif
+  }
+
+private:
+#ifdef __linux__
+  // E.g.: "0-3,8-11", it stops at the first malformed range
+  static std::vector<size_t> parseCpuList(std::FILE* file)
+  {
+    auto cores = std::vector<size_t>{};
+    for (size_t first = 0; std::fscanf(file, "%zu", &first) == 1;)
+    {
+      auto last = first;
+      auto separator = std::fgetc(file);
+      if (separator == '-')
+      {
+        if (std::fscanf(file, "%zu", &last) != 1)
+          break;
+
+        separator = std::fgetc(file);
+      }
+
+      for (auto core = first; core <= last; ++core)
+        cores.push_back(core);
+
+      if (separator != ',')
+        break;
+    }
+
+    return cores;
+  }
+#endif
+};
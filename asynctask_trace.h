@@ -0,0 +1,78 @@
+/*
+MIT License
+
+Copyright (c) 2020 Attila Csikós (attcs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+// Trace sinks of the AsyncTaskStats (see AsyncTaskBase::enableStats()). They are separated from the asynctask.h: only their users pay for the <ostream>.
+
+#include "asynctask.h"
+
+#include <ostream>
+
+
+// Trace sink which writes Chrome trace JSON events (chrome://tracing, Perfetto UI): "queued", "doInBackground" and "dispatch" spans on the track of the task, the counters are the args of the "doInBackground".
+// The JSON array is closed by the Dtor. Thread-safe: tasks of many main threads could share it.
+class AsyncTaskChromeTraceSink : public AsyncTaskTraceSink
+{
+private:
+  std::ostream& mOut;
+  std::mutex mMutex;
+  bool isFirstEvent = true;
+
+public:
+  explicit AsyncTaskChromeTraceSink(std::ostream& out) : mOut(out) { mOut << "["; }
+  AsyncTaskChromeTraceSink(AsyncTaskChromeTraceSink const&) = delete;
+  AsyncTaskChromeTraceSink& operator=(AsyncTaskChromeTraceSink const&) = delete;
+  ~AsyncTaskChromeTraceSink() override { mOut << "\n]\n"; }
+
+  void onTaskFinished(void const* task, AsyncTaskStats const& stats) noexcept override
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    auto const tid = reinterpret_cast<uintptr_t>(task);
+    writeSpan("queued", tid, stats.tExecute, stats.tStart);
+    mOut << "}";
+    writeSpan("doInBackground", tid, stats.tStart, stats.tFinish);
+    mOut << ",\"args\":{\"published\":" << stats.nPublished
+      << ",\"throttled\":" << stats.nThrottled
+      << ",\"stored\":" << stats.nStored
+      << ",\"coalesced\":" << stats.nCoalesced
+      << ",\"dropped\":" << stats.nDropped
+      << ",\"queueHighWater\":" << stats.nQueueHighWater << "}}";
+    writeSpan("dispatch", tid, stats.tFinish, stats.tDispatch);
+    mOut << "}";
+    mOut.flush();
+  }
+
+private:
+  // Complete event in microseconds of the steady clock, its object is left open for the args
+  void writeSpan(char const* name, uintptr_t tid, AsyncTaskStats::Clock::time_point tBegin, AsyncTaskStats::Clock::time_point tEnd)
+  {
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+    mOut << (std::exchange(isFirstEvent, false) ? "\n" : ",\n")
+      << "{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+      << ",\"ts\":" << duration_cast<microseconds>(tBegin.time_since_epoch()).count()
+      << ",\"dur\":" << duration_cast<microseconds>(tEnd - tBegin).count();
+  }
+};
@@ -0,0 +1,215 @@
+#include "asynctask.h"
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+  // Progress types of the storage strategies
+  struct ProgressLarge
+  {
+    std::array<int, 64> data{}; // Trivially copyable, but not lock-free: SeqLock
+
+    ProgressLarge() = default;
+    ProgressLarge(int i) { data[0] = i; }
+  };
+
+  struct ProgressStress
+  {
+    std::vector<int> dataMember;
+    std::wstring dataMemberString;
+
+    ProgressStress() = default;
+    ProgressStress(int i) { dataMember.resize(1000000); dataMember[1] = i; }
+  };
+
+  struct ProgressStressTriple : ProgressStress
+  {
+    using ProgressStress::ProgressStress;
+  };
+}
+
+template<>
+struct AsyncTaskProgressStorageOf<ProgressStressTriple>
+{
+  static AsyncTaskProgressStorage constexpr value = AsyncTaskProgressStorage::TripleBuffer;
+};
+
+namespace
+{
+  AsyncTaskExecutor& ThreadExecutor() { return AsyncTaskThreadExecutor::getDefault(); }
+
+  AsyncTaskExecutor& ThreadPool()
+  {
+    static AsyncTaskThreadPool pool;
+    return pool;
+  }
+
+
+  // It records the start of the doInBackground()
+  class AsyncTaskStart final : public AsyncTask<int, int, int>
+  {
+  public:
+    std::chrono::steady_clock::time_point tStart;
+
+    using AsyncTask<int, int, int>::AsyncTask;
+
+  protected:
+    int doInBackground(int const& n) override
+    {
+      tStart = std::chrono::steady_clock::now();
+      return n;
+    }
+  };
+
+  // It publishes the same progress n times
+  template<typename AsyncTaskT, typename Progress>
+  class AsyncTaskPublisher final : public AsyncTaskT
+  {
+  public:
+    Progress const& progress;
+    size_t nHandled = 0;
+
+    AsyncTaskPublisher(AsyncTaskExecutor& executor, Progress const& progress) : AsyncTaskT(executor), progress(progress) {}
+
+  protected:
+    int doInBackground(int const& n) override
+    {
+      for (int i = 0; i < n; ++i)
+        this->publishProgress(progress);
+
+      return n;
+    }
+
+    void onProgressUpdate(Progress const&) override { ++nHandled; }
+  };
+
+  // It waits for the cancellation
+  template<typename AsyncTaskT>
+  class AsyncTaskIdle final : public AsyncTaskT
+  {
+  protected:
+    int doInBackground(int const&) override
+    {
+      this->getCancellationToken().waitFor(std::chrono::hours(1));
+      return 0;
+    }
+  };
+
+
+  // execute() to doInBackground() start latency
+  void BM_StartLatency(benchmark::State& state, AsyncTaskExecutor& (*fnExecutor)())
+  {
+    for (auto _ : state)
+    {
+      AsyncTaskStart at(fnExecutor());
+      auto const tExecute = std::chrono::steady_clock::now();
+      at.execute(0);
+      at.get();
+      state.SetIterationTime(std::chrono::duration<double>(at.tStart - tExecute).count());
+    }
+  }
+  BENCHMARK_CAPTURE(BM_StartLatency, ThreadExecutor, &ThreadExecutor)->UseManualTime();
+  BENCHMARK_CAPTURE(BM_StartLatency, ThreadPool, &ThreadPool)->UseManualTime();
+
+
+  // execute() to get() end-to-end latency of state.range(0) concurrent tasks
+  void BM_GetLatency(benchmark::State& state, AsyncTaskExecutor& (*fnExecutor)())
+  {
+    auto const nTask = static_cast<size_t>(state.range(0));
+    for (auto _ : state)
+    {
+      state.PauseTiming();
+      auto vTask = std::vector<std::unique_ptr<AsyncTaskStart>>(nTask);
+      for (auto& pTask : vTask)
+        pTask = std::make_unique<AsyncTaskStart>(fnExecutor());
+      state.ResumeTiming();
+
+      for (auto& pTask : vTask)
+        pTask->execute(0);
+
+      for (auto& pTask : vTask)
+        benchmark::DoNotOptimize(pTask->get());
+
+      state.PauseTiming();
+      vTask.clear();
+      state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+  }
+  BENCHMARK_CAPTURE(BM_GetLatency, ThreadExecutor, &ThreadExecutor)->Arg(1)->Arg(16)->Arg(256);
+  BENCHMARK_CAPTURE(BM_GetLatency, ThreadPool, &ThreadPool)->Arg(1)->Arg(16)->Arg(256);
+
+
+  // publishProgress() throughput of state.range(0) concurrent tasks, each of them publishes state.range(1) progress, the main thread runs the callback loops
+  template<typename AsyncTaskT, typename Progress>
+  void BM_PublishProgress(benchmark::State& state)
+  {
+    auto const nTask = static_cast<size_t>(state.range(0));
+    auto const nPublish = static_cast<int>(state.range(1));
+    auto const progress = Progress(1);
+    size_t nHandled = 0;
+    for (auto _ : state)
+    {
+      state.PauseTiming();
+      auto vTask = std::vector<std::unique_ptr<AsyncTaskPublisher<AsyncTaskT, Progress>>>(nTask);
+      for (auto& pTask : vTask)
+        pTask = std::make_unique<AsyncTaskPublisher<AsyncTaskT, Progress>>(ThreadPool(), progress);
+      state.ResumeTiming();
+
+      for (auto& pTask : vTask)
+        pTask->execute(nPublish);
+
+      for (auto isFinished = false; !isFinished;)
+      {
+        isFinished = true;
+        for (auto& pTask : vTask)
+          isFinished &= pTask->onCallbackLoop();
+      }
+
+      state.PauseTiming();
+      for (auto const& pTask : vTask)
+        nHandled += pTask->nHandled;
+      vTask.clear();
+      state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0) * state.range(1));
+    state.counters["handled"] = benchmark::Counter(static_cast<double>(nHandled), benchmark::Counter::kAvgIterations);
+  }
+
+  void PublishSmall(benchmark::internal::Benchmark* b) { b->Args({ 1, 1 << 16 })->Args({ 16, 1 << 12 }); }
+  void PublishStress(benchmark::internal::Benchmark* b) { b->Args({ 1, 64 })->Args({ 4, 16 }); }
+
+  BENCHMARK_TEMPLATE(BM_PublishProgress, AsyncTask<int, int, int>, int)->Apply(PublishSmall);
+  BENCHMARK_TEMPLATE(BM_PublishProgress, AsyncTaskStatic<int, int, int>, int)->Apply(PublishSmall);
+  BENCHMARK_TEMPLATE(BM_PublishProgress, AsyncTaskPQ<int, int, int>, int)->Apply(PublishSmall);
+  BENCHMARK_TEMPLATE(BM_PublishProgress, AsyncTaskPQRingBuffer<64, AsyncTaskOverflowPolicy::DropOldest, int, int, int>, int)->Apply(PublishSmall);
+  BENCHMARK_TEMPLATE(BM_PublishProgress, AsyncTask<ProgressLarge, int, int>, ProgressLarge)->Apply(PublishSmall);
+  BENCHMARK_TEMPLATE(BM_PublishProgress, AsyncTaskPQ<ProgressLarge, int, int>, ProgressLarge)->Apply(PublishSmall);
+  BENCHMARK_TEMPLATE(BM_PublishProgress, AsyncTask<ProgressStress, int, int>, ProgressStress)->Apply(PublishStress);
+  BENCHMARK_TEMPLATE(BM_PublishProgress, AsyncTask<ProgressStressTriple, int, int>, ProgressStressTriple)->Apply(PublishStress);
+  BENCHMARK_TEMPLATE(BM_PublishProgress, AsyncTaskPQ<ProgressStress, int, int>, ProgressStress)->Apply(PublishStress);
+
+
+  // onCallbackLoop() cost if there is nothing to handle
+  template<typename AsyncTaskT>
+  void BM_OnCallbackLoopIdle(benchmark::State& state)
+  {
+    AsyncTaskIdle<AsyncTaskT> at;
+    at.execute(0);
+    for (auto _ : state)
+      benchmark::DoNotOptimize(at.onCallbackLoop());
+
+    at.cancel();
+    at.get();
+  }
+  BENCHMARK_TEMPLATE(BM_OnCallbackLoopIdle, AsyncTask<int, int, int>);
+  BENCHMARK_TEMPLATE(BM_OnCallbackLoopIdle, AsyncTaskPQ<int, int, int>);
+  BENCHMARK_TEMPLATE(BM_OnCallbackLoopIdle, AsyncTaskPQRingBuffer<64, AsyncTaskOverflowPolicy::DropOldest, int, int, int>);
+}
+
+BENCHMARK_MAIN();
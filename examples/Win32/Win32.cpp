@@ -215,27 +215,29 @@ namespace
     {
       auto const n = m1.size();
       auto m = Result(N);
-      auto p = Progress();
-      for (size_t i = 0; i < n; ++i)
-      {
-        m[i].resize(N);
-        for (size_t j = 0; j < n; ++j)
-        {
-          m[i][j] = matrix_product_element(m1, m2, i, j);
-          if (isCancelled())
-            break;
-        }
-        
-        if (i == 100)
-          p.szFeedback = L"Async thread report: Over the 100th row!";
-        else if (i == 500)
-          p.szFeedback = L"Async thread report: Over the 500th row!";
-        else if (i == 900)
-          p.szFeedback = L"Async thread report: Almost finish!";
-          
-        p.iP = static_cast<int>(i);
-        publishProgress(p);
-      }
+
+      // Rows are calculated on every core, the progress is published only by this thread
+      parallelFor(0, n, 1
+        , [&](size_t i)
+          {
+            m[i].resize(N);
+            for (size_t j = 0; j < n && !isCancelled(); ++j)
+              m[i][j] = matrix_product_element(m1, m2, i, j);
+          }
+        , [&](size_t nDone, size_t)
+          {
+            auto p = Progress();
+            if (nDone >= 900)
+              p.szFeedback = L"Async thread report: Almost finish!";
+            else if (nDone >= 500)
+              p.szFeedback = L"Async thread report: Over the 500th row!";
+            else if (nDone >= 100)
+              p.szFeedback = L"Async thread report: Over the 100th row!";
+
+            p.iP = static_cast<int>(nDone);
+            publishProgress(p);
+          });
+
       return m;
     }
 
@@ -281,39 +283,32 @@ namespace
   std::unique_ptr<AsyncCalculation> pAsyncCalculation;
 }
 
-#define IDT_TIMER1 10000
+#define WM_ASYNCTASK_UPDATE (WM_APP + 1)
 
 // Message handler for Calculation dialog.
 INT_PTR CALLBACK DlgCalcProc(HWND hDlg, UINT message, WPARAM wParam, LPARAM lParam)
 {
   UNREFERENCED_PARAMETER(lParam);
-  static UINT_PTR idTimer;
 
   switch (message)
   {
     case WM_INITDIALOG:
     {
-      idTimer = SetTimer(hDlg, IDT_TIMER1, 10, NULL);
-      
       auto const m1 = matrix_random(N, N);
       auto const m2 = matrix_random(N, N);
 
       pAsyncCalculation.reset(new AsyncCalculation());
       pAsyncCalculation->hDlg = hDlg;
+      pAsyncCalculation->setWakeUpCallback([hDlg] { PostMessage(hDlg, WM_ASYNCTASK_UPDATE, 0, 0); }); // No polling timer is needed
 
       pAsyncCalculation->execute(m1, m2);
 
       return (INT_PTR)TRUE;
     }
     
-    case WM_TIMER:
-      switch (wParam)
-      {
-        case IDT_TIMER1:
-          pAsyncCalculation->onCallbackLoop();
-          return FALSE;
-      }
-      break;
+    case WM_ASYNCTASK_UPDATE:
+      pAsyncCalculation->onCallbackLoop();
+      return TRUE;
       
     case WM_COMMAND:
       switch (LOWORD(wParam))
@@ -338,11 +333,6 @@ INT_PTR CALLBACK DlgCalcProc(HWND hDlg, UINT message, WPARAM wParam, LPARAM lPar
           break;
       }
       break;
-
-    case WM_DESTROY:
-      KillTimer(hDlg, idTimer);
-      break;
-
   }
 
   return (INT_PTR)FALSE;
@@ -0,0 +1,279 @@
+#include "asynctask.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "psapi")
+#endif
+#else
+#include <sys/resource.h>
+#endif
+
+// Stress and scaling test: 1..maxTasks simultaneous AsyncTask and AsyncTaskPQ instances with mixed completion, cancellation and exception paths.
+// Every task's callbacks are verified, the throughput and the memory high-water marks are reported per scale.
+// Usage: asynctask_stress [maxTasks = 10000] [maxSlowdown = 0]
+//  - maxSlowdown: allowed per-task time of the largest scale relative to the 100 tasks, 0: no check.
+// Exit code is non-zero if any verification or the slowdown check fails.
+namespace
+{
+  // Thread-safe counting resource for the tasks' and the pool's allocations
+  class AsyncTaskCountingResource final : public std::pmr::memory_resource
+  {
+    std::pmr::memory_resource* mUpstream = std::pmr::new_delete_resource();
+    std::atomic<size_t> mCurrent = { 0 };
+    std::atomic<size_t> mPeak = { 0 };
+
+  public:
+    size_t getPeak() const noexcept { return mPeak.load(); }
+    void resetPeak() noexcept { mPeak.store(mCurrent.load()); }
+
+  protected:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+      auto const p = mUpstream->allocate(bytes, alignment);
+      auto const current = mCurrent.fetch_add(bytes) + bytes;
+      for (auto peak = mPeak.load(); peak < current && !mPeak.compare_exchange_weak(peak, current);)
+        ;
+
+      return p;
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override
+    {
+      mCurrent.fetch_sub(bytes);
+      mUpstream->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override { return this == &other; }
+  };
+
+  // Peak resident set size of the process in KiB, 0 if it is not available
+  size_t GetPeakRss()
+  {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters{};
+    return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.PeakWorkingSetSize / 1024 : 0;
+#else
+    rusage usage{};
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? static_cast<size_t>(usage.ru_maxrss) : 0;
+#endif
+  }
+
+  enum class Path : int
+  {
+    Complete,
+    Cancel,
+    Throw
+  };
+
+  struct AsyncTaskStressError : std::runtime_error
+  {
+    AsyncTaskStressError() : std::runtime_error("stress") {}
+  };
+
+  // It publishes nPublish progress, then it completes, throws or waits for the cancellation by its path
+  template<typename AsyncTaskT>
+  class AsyncTaskStress final : public AsyncTaskT
+  {
+  public:
+    Path const path;
+    int const nPublish;
+    int nPublished = 0; // Written by the worker, read after the finish
+    int progressLast = -1;
+    size_t nProgressHandled = 0;
+    bool isOrdered = true;
+    bool isPostExecuted = false;
+    bool isCancelCalled = false;
+    bool isThrown = false;
+
+    AsyncTaskStress(AsyncTaskExecutor& executor, std::pmr::memory_resource& memoryResource, Path path, int nPublish)
+      : AsyncTaskT(executor, memoryResource), path(path), nPublish(nPublish)
+    {}
+
+    bool isVerified(int param)
+    {
+      if (!isOrdered || nProgressHandled > static_cast<size_t>(nPublish))
+        return false;
+
+      switch (path)
+      {
+        case Path::Complete: return isPostExecuted && !isCancelCalled && this->get() == param;
+        case Path::Cancel: return isCancelCalled && !isPostExecuted;
+        case Path::Throw: return isThrown && isCancelCalled && !isPostExecuted; // The exception cancels the task
+        default: return false;
+      }
+    }
+
+  protected:
+    int doInBackground(int const& param) override
+    {
+      for (; nPublished < nPublish && !this->isCancelled(); ++nPublished)
+        this->publishProgress(nPublished);
+
+      switch (path)
+      {
+        case Path::Complete: return param;
+        case Path::Throw: throw AsyncTaskStressError();
+        case Path::Cancel: this->getCancellationToken().waitFor(std::chrono::hours(1)); return -1;
+        default: return -1;
+      }
+    }
+
+    void onProgressUpdate(int const& progress) override
+    {
+      isOrdered &= progressLast < progress;
+      progressLast = progress;
+      ++nProgressHandled;
+    }
+
+    void onPostExecute(int const&) override { isPostExecuted = true; }
+    void onCancelled() override { isCancelCalled = true; }
+  };
+
+  struct Measure
+  {
+    double seconds = 0.0;
+    size_t nProgress = 0;
+    size_t nFailed = 0;
+    size_t bytesPeak = 0;
+  };
+
+  // Execute nTask simultaneous tasks, every third of them is cancelled while it is running, every third throws. The main thread runs the callback loops.
+  template<typename AsyncTaskT>
+  Measure Run(AsyncTaskExecutor& executor, AsyncTaskCountingResource& memoryResource, size_t nTask, int nPublish)
+  {
+    using Task = AsyncTaskStress<AsyncTaskT>;
+
+    auto measure = Measure{};
+    memoryResource.resetPeak();
+    auto const t0 = std::chrono::steady_clock::now();
+    {
+      auto vTask = std::vector<std::unique_ptr<Task>>(nTask);
+      for (size_t i = 0; i < nTask; ++i)
+        vTask[i] = std::make_unique<Task>(executor, memoryResource, static_cast<Path>(i % 3), nPublish);
+
+      for (size_t i = 0; i < nTask; ++i)
+        vTask[i]->execute(static_cast<int>(i));
+
+      for (auto const& pTask : vTask)
+        if (pTask->path == Path::Cancel)
+          pTask->cancel();
+
+      auto vRunning = std::vector<Task*>();
+      vRunning.reserve(nTask);
+      for (auto const& pTask : vTask)
+        vRunning.push_back(pTask.get());
+
+      while (!vRunning.empty())
+      {
+        auto const nRunning = vRunning.size();
+        for (size_t i = 0; i < vRunning.size();)
+        {
+          auto isFinished = false;
+          try
+          {
+            isFinished = vRunning[i]->onCallbackLoop();
+          }
+          catch (AsyncTaskStressError const&)
+          {
+            vRunning[i]->isThrown = true;
+            isFinished = true;
+          }
+
+          if (isFinished)
+          {
+            vRunning[i] = vRunning.back();
+            vRunning.pop_back();
+          }
+          else
+            ++i;
+        }
+
+        if (nRunning == vRunning.size())
+          vRunning.front()->waitForUpdate(std::chrono::milliseconds(1));
+      }
+
+      for (size_t i = 0; i < nTask; ++i)
+      {
+        measure.nProgress += static_cast<size_t>(vTask[i]->nPublished);
+        if (!vTask[i]->isVerified(static_cast<int>(i)))
+          ++measure.nFailed;
+      }
+    }
+    measure.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    measure.bytesPeak = memoryResource.getPeak();
+    return measure;
+  }
+
+  struct Scaling
+  {
+    double secondsPerTaskOf100 = 0.0;
+    double secondsPerTaskOfMax = 0.0;
+  };
+
+  template<typename AsyncTaskT>
+  bool RunScales(char const* name, AsyncTaskExecutor& executor, AsyncTaskCountingResource& memoryResource, size_t maxTasks, int nPublish, Scaling& scaling)
+  {
+    auto isPassed = true;
+    for (size_t nTask = 1; nTask <= maxTasks; nTask *= 10)
+    {
+      auto const measure = Run<AsyncTaskT>(executor, memoryResource, nTask, nPublish);
+      std::printf("%-24s %8zu %10.3f %12.0f %14.0f %14zu %12zu %s\n"
+        , name, nTask, measure.seconds * 1000.0, nTask / measure.seconds, measure.nProgress / measure.seconds
+        , measure.bytesPeak, GetPeakRss(), measure.nFailed == 0 ? "ok" : "FAILED");
+      std::fflush(stdout);
+
+      isPassed &= measure.nFailed == 0;
+      if (nTask == 100)
+        scaling.secondsPerTaskOf100 = measure.seconds / nTask;
+
+      scaling.secondsPerTaskOfMax = measure.seconds / nTask;
+    }
+    return isPassed;
+  }
+
+  template<typename AsyncTaskT>
+  bool RunScalesChecked(char const* name, AsyncTaskExecutor& executor, AsyncTaskCountingResource& memoryResource, size_t maxTasks, int nPublish, double maxSlowdown)
+  {
+    auto scaling = Scaling{};
+    auto const isPassed = RunScales<AsyncTaskT>(name, executor, memoryResource, maxTasks, nPublish, scaling);
+    if (maxSlowdown <= 0.0 || scaling.secondsPerTaskOf100 == 0.0 || maxTasks <= 100)
+      return isPassed;
+
+    auto const slowdown = scaling.secondsPerTaskOfMax / scaling.secondsPerTaskOf100;
+    std::printf("%-24s slowdown of the largest scale: %.2f (max: %.2f) %s\n", name, slowdown, maxSlowdown, slowdown <= maxSlowdown ? "ok" : "FAILED");
+    return isPassed && slowdown <= maxSlowdown;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  auto const maxTasks = argc > 1 ? static_cast<size_t>(std::strtoull(argv[1], nullptr, 10)) : size_t(10000);
+  auto const maxSlowdown = argc > 2 ? std::strtod(argv[2], nullptr) : 0.0;
+  constexpr int nPublish = 100;
+  constexpr size_t maxThreadTasks = 100; // AsyncTaskThreadExecutor starts one thread per task
+
+  auto memoryResource = AsyncTaskCountingResource();
+  auto pool = AsyncTaskThreadPool(std::thread::hardware_concurrency(), memoryResource);
+
+  std::printf("%-24s %8s %10s %12s %14s %14s %12s\n", "task", "n", "ms", "tasks/s", "published/s", "peak bytes", "peak rss KiB");
+  auto isPassed = true;
+  isPassed &= RunScalesChecked<AsyncTask<int, int, int>>("AsyncTask/pool", pool, memoryResource, maxTasks, nPublish, maxSlowdown);
+  isPassed &= RunScalesChecked<AsyncTaskPQ<int, int, int>>("AsyncTaskPQ/pool", pool, memoryResource, maxTasks, nPublish, maxSlowdown);
+  isPassed &= RunScalesChecked<AsyncTask<int, int, int>>("AsyncTask/thread", AsyncTaskThreadExecutor::getDefault(), memoryResource, std::min(maxTasks, maxThreadTasks), nPublish, 0.0);
+  isPassed &= RunScalesChecked<AsyncTaskPQ<int, int, int>>("AsyncTaskPQ/thread", AsyncTaskThreadExecutor::getDefault(), memoryResource, std::min(maxTasks, maxThreadTasks), nPublish, 0.0);
+
+  std::printf("%s\n", isPassed ? "PASSED" : "FAILED");
+  return isPassed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
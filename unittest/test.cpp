@@ -5,8 +5,15 @@
 #include <atomic>
 #include <vector>
 #include <string>
+#include <memory_resource>
+#include <limits>
+#include <numeric>
+#include <sstream>
 
 #include "../asynctask.h"
+#include "../asynctask_cache.h"
+#include "../asynctask_numa.h"
+#include "../asynctask_trace.h"
 
 namespace
 {
@@ -263,7 +270,7 @@ namespace AsyncTaskTest
     {
     private:
       LogService* log = nullptr;
-      std::chrono::milliseconds const& t;
+      std::chrono::milliseconds t;
 
     public:
       AsyncTaskWorkerLogProgressTemplate(LogService* log, std::chrono::milliseconds const& t = std::chrono::milliseconds(10)) : log(log), t(t) {}
@@ -567,4 +574,3095 @@ namespace AsyncTaskTest
     }
 
   }
+
+  namespace Executor
+  {
+    class AsyncTaskSum : public AsyncTask<int, int, int>
+    {
+    public:
+      using AsyncTask<int, int, int>::AsyncTask;
+
+    protected:
+      int doInBackground(int const& n) override
+      {
+        auto sum = 0;
+        for (int i = 0; i < n; ++i)
+        {
+          sum += i;
+          publishProgress(i);
+          if (isCancelled())
+            return -1;
+        }
+
+        if (n < 0)
+          throw n;
+
+        return sum;
+      }
+    };
+
+    TEST(Executor, ThreadPool_ManyTasks_AllResultsAreCorrect)
+    {
+      AsyncTaskThreadPool pool(2);
+
+      std::vector<std::unique_ptr<AsyncTaskSum>> tasks;
+      for (int i = 0; i < 100; ++i)
+        tasks.emplace_back(std::make_unique<AsyncTaskSum>(pool))->execute(i);
+
+      for (int i = 0; i < 100; ++i)
+        EXPECT_EQ(i * (i - 1) / 2, tasks[i]->get());
+    }
+
+    TEST(Executor, ThreadPool_Exception_getRethrow)
+    {
+      AsyncTaskThreadPool pool(1);
+      AsyncTaskSum at(pool);
+      at.execute(-1);
+      EXPECT_THROW(at.get(), int);
+    }
+
+    TEST(Executor, ThreadPool_Cancelled_onCallbackLoopFinish)
+    {
+      AsyncTaskThreadPool pool(1);
+      AsyncTaskSum at(pool);
+      at.execute(1000000);
+      at.cancel();
+      while (!at.onCallbackLoop());
+      EXPECT_EQ(AsyncTaskSum::Status::FINISHED, at.getStatus());
+    }
+
+    TEST(Executor, ThreadPool_DtorDuringRunning_NoThrow)
+    {
+      AsyncTaskThreadPool pool(1);
+      try
+      {
+        AsyncTaskSum at1(pool), at2(pool);
+        at1.execute(1000000);
+        at2.execute(1000000); // queued behind at1, cancelled before start
+      }
+      catch (...)
+      {
+        EXPECT_TRUE(false);
+      }
+    }
+  }
+
+  namespace ProgressQueue
+  {
+    static auto const fnNoAlteration = [](int const&, int const&) -> std::optional<int> { return std::nullopt; };
+    static auto const fnSumAlteration = [](int const& o, int const& n) -> std::optional<int> { return o + n; };
+    static auto const noInterruption = AsyncTaskCancellationToken(); // Never cancelled
+
+    static std::vector<int> Consume(AsyncTaskProgressRingBuffer<int, 4, AsyncTaskOverflowPolicy::DropOldest>& queue)
+    {
+      std::vector<int> items;
+      queue.consume([&](int const& i) { items.push_back(i); });
+      return items;
+    }
+
+    TEST(ProgressQueue, RingBuffer_DropOldest_LastOnesAreKept)
+    {
+      AsyncTaskProgressRingBuffer<int, 4, AsyncTaskOverflowPolicy::DropOldest> queue;
+      for (int i = 0; i < 10; ++i)
+        queue.store(i, fnNoAlteration, noInterruption);
+
+      EXPECT_EQ(std::vector<int>({ 6, 7, 8, 9 }), Consume(queue));
+      EXPECT_TRUE(Consume(queue).empty());
+
+      queue.store(10, fnNoAlteration, noInterruption);
+      EXPECT_EQ(std::vector<int>({ 10 }), Consume(queue));
+    }
+
+    TEST(ProgressQueue, RingBuffer_Coalesce_OverflowIsMergedAndFlushed)
+    {
+      AsyncTaskProgressRingBuffer<int, 2, AsyncTaskOverflowPolicy::Coalesce> queue;
+      for (int i = 0; i < 10; ++i)
+        queue.store(1, fnSumAlteration, noInterruption);
+
+      std::vector<int> items;
+      queue.consume([&](int const& i) { items.push_back(i); });
+      EXPECT_EQ(std::vector<int>({ 1, 1 }), items);
+
+      queue.flush(noInterruption);
+      queue.consume([&](int const& i) { items.push_back(i); });
+      EXPECT_EQ(std::vector<int>({ 1, 1, 8 }), items);
+    }
+
+    TEST(ProgressQueue, RingBuffer_Block_EveryItemInOrder)
+    {
+      int constexpr n = 10000;
+      AsyncTaskProgressRingBuffer<int, 2, AsyncTaskOverflowPolicy::Block> queue;
+      std::thread producer([&] { for (int i = 0; i < n; ++i) queue.store(i, fnNoAlteration, noInterruption); });
+
+      std::vector<int> items;
+      while (items.size() < n)
+        queue.consume([&](int const& i) { items.push_back(i); });
+      producer.join();
+
+      for (int i = 0; i < n; ++i)
+        ASSERT_EQ(i, items[i]);
+    }
+
+    TEST(ProgressQueue, RingBuffer_BlockDetached_StoreDoesNotWait)
+    {
+      AsyncTaskProgressRingBuffer<int, 1, AsyncTaskOverflowPolicy::Block> queue;
+      queue.store(0, fnNoAlteration, noInterruption);
+      queue.detach();
+      queue.store(1, fnNoAlteration, noInterruption);
+
+      std::vector<int> items;
+      queue.consume([&](int const& i) { items.push_back(i); });
+      EXPECT_EQ(std::vector<int>({ 0 }), items);
+    }
+
+    TEST(ProgressQueue, RingBuffer_BlockFull_WokenUpByTheCancellation)
+    {
+      AsyncTaskProgressRingBuffer<int, 1, AsyncTaskOverflowPolicy::Block> queue;
+      AsyncTaskCancellationState cancellation;
+      queue.store(0, fnNoAlteration, noInterruption);
+
+      auto result = AsyncTaskProgressStoreResult{};
+      std::thread producer([&] { result = queue.store(1, fnNoAlteration, AsyncTaskCancellationToken(cancellation)); });
+      Wait();
+      cancellation.cancel();
+      producer.join();
+
+      EXPECT_EQ(size_t(1), result.nDropped);
+      std::vector<int> items;
+      queue.consume([&](int const& i) { items.push_back(i); });
+      EXPECT_EQ(std::vector<int>({ 0 }), items);
+    }
+
+    TEST(ProgressQueue, RingBuffer_BlockFull_WokenUpByTheDetach)
+    {
+      AsyncTaskProgressRingBuffer<int, 1, AsyncTaskOverflowPolicy::Block> queue;
+      queue.store(0, fnNoAlteration, noInterruption);
+
+      std::thread producer([&] { queue.store(1, fnNoAlteration, noInterruption); });
+      Wait();
+      queue.detach();
+      producer.join();
+    }
+
+    TEST(ProgressQueue, RingBuffer_CoalesceFlush_WokenUpByTheConsumer)
+    {
+      AsyncTaskProgressRingBuffer<int, 1, AsyncTaskOverflowPolicy::Coalesce> queue;
+      queue.store(0, fnNoAlteration, noInterruption);
+      queue.store(1, fnNoAlteration, noInterruption); // Pending as the spare
+
+      std::thread producer([&] { queue.flush(noInterruption); });
+      Wait();
+      std::vector<int> items;
+      queue.consume([&](int const& i) { items.push_back(i); });
+      producer.join();
+
+      queue.consume([&](int const& i) { items.push_back(i); });
+      EXPECT_EQ(std::vector<int>({ 0, 1 }), items);
+    }
+
+    class AsyncTaskPQRingBufferBlock : public AsyncTaskPQRingBuffer<4, AsyncTaskOverflowPolicy::Block, int, int, int>
+    {
+    public:
+      std::vector<int> items;
+
+    protected:
+      int doInBackground(int const& n) override
+      {
+        for (int i = 0; i < n; ++i)
+          publishProgress(i);
+
+        return n;
+      }
+
+      void onProgressUpdate(int const& i) override { items.push_back(i); }
+    };
+
+    TEST(ProgressQueue, AsyncTaskPQRingBuffer_Block_NoGap)
+    {
+      AsyncTaskPQRingBufferBlock at;
+      at.execute(1000);
+      while (!at.onCallbackLoop());
+
+      EXPECT_EQ(1000, at.get());
+      for (size_t i = 0; i < at.items.size(); ++i)
+        ASSERT_EQ(int(i), at.items[i]);
+    }
+
+    TEST(ProgressQueue, RingBuffer_consumeBatch_OneContiguousCall)
+    {
+      AsyncTaskProgressRingBuffer<int, 4, AsyncTaskOverflowPolicy::DropOldest> queue;
+      for (int i = 0; i < 3; ++i)
+        queue.store(i, fnNoAlteration, noInterruption);
+
+      std::vector<std::vector<int>> batches;
+      queue.consumeBatch([&](int const* data, size_t size) { batches.emplace_back(data, data + size); });
+      queue.consumeBatch([&](int const* data, size_t size) { batches.emplace_back(data, data + size); });
+      EXPECT_EQ(std::vector<std::vector<int>>({ { 0, 1, 2 } }), batches);
+
+      queue.store(3, fnNoAlteration, noInterruption);
+      EXPECT_EQ(std::vector<int>({ 3 }), Consume(queue));
+    }
+
+    template<typename AsyncTaskT>
+    class AsyncTaskBatched : public AsyncTaskT
+    {
+    public:
+      std::vector<std::vector<int>> batches;
+
+    protected:
+      int doInBackground(int const& n) override
+      {
+        for (int i = 0; i < n; ++i)
+          this->publishProgress(i);
+
+        return n;
+      }
+
+      void onProgressUpdate(int const&) override { ADD_FAILURE(); }
+      void onProgressUpdateBatch(AsyncTaskSpan<int> progressItems) override { batches.emplace_back(progressItems.begin(), progressItems.end()); }
+
+    public:
+      void handleProgressLeft() { this->handleProgress(); }
+
+      std::vector<int> joined() const
+      {
+        std::vector<int> items;
+        for (auto const& batch : batches)
+          items.insert(items.end(), batch.begin(), batch.end());
+        return items;
+      }
+    };
+
+    TEST(ProgressQueue, AsyncTaskPQ_onProgressUpdateBatch_AllPendingAtOnce)
+    {
+      AsyncTaskBatched<AsyncTaskPQ<int, int, int>> at;
+      at.execute(1000);
+      EXPECT_EQ(1000, at.get());
+      at.handleProgressLeft();
+      at.handleProgressLeft();
+
+      ASSERT_EQ(1, at.batches.size());
+      ASSERT_EQ(1000, at.batches[0].size());
+      for (int i = 0; i < 1000; ++i)
+        ASSERT_EQ(i, at.batches[0][i]);
+    }
+
+    TEST(ProgressQueue, AsyncTaskPQRingBuffer_onProgressUpdateBatch_NoGap)
+    {
+      AsyncTaskBatched<AsyncTaskPQRingBuffer<4, AsyncTaskOverflowPolicy::Block, int, int, int>> at;
+      at.execute(1000);
+      while (!at.onCallbackLoop());
+      at.handleProgressLeft();
+
+      auto const items = at.joined();
+      ASSERT_EQ(1000, items.size());
+      for (int i = 0; i < 1000; ++i)
+        ASSERT_EQ(i, items[i]);
+
+      for (auto const& batch : at.batches)
+        EXPECT_LE(batch.size(), 4);
+    }
+  }
+
+  namespace Copy
+  {
+    struct CopyCounted
+    {
+      static std::atomic<int> nCopy;
+      int value = 0;
+
+      CopyCounted() = default;
+      CopyCounted(int value) : value(value) {}
+      CopyCounted(CopyCounted const& other) : value(other.value) { ++nCopy; }
+      CopyCounted(CopyCounted&&) = default;
+      CopyCounted& operator=(CopyCounted const& other) { value = other.value; ++nCopy; return *this; }
+      CopyCounted& operator=(CopyCounted&&) = default;
+    };
+    std::atomic<int> CopyCounted::nCopy = 0;
+
+    template<typename AsyncTaskT>
+    class AsyncTaskCopyCounted : public AsyncTaskT
+    {
+    public:
+      int nCopyOfStore = 0;
+
+    protected:
+      CopyCounted doInBackground(int const& n) override
+      {
+        for (int i = 0; i < n; ++i)
+          this->publishProgress(CopyCounted(i));
+
+        nCopyOfStore = CopyCounted::nCopy.load();
+        return CopyCounted(n);
+      }
+    };
+
+    TEST(Copy, AsyncTask_publishProgressRvalue_NoCopyAtStore)
+    {
+      CopyCounted::nCopy = 0;
+      AsyncTaskCopyCounted<AsyncTask<CopyCounted, CopyCounted, int>> at;
+      at.execute(100);
+      at.get();
+      EXPECT_EQ(0, at.nCopyOfStore);
+    }
+
+    TEST(Copy, AsyncTaskPQ_publishProgressRvalue_NoCopyAtStoreAndHandle)
+    {
+      CopyCounted::nCopy = 0;
+      AsyncTaskCopyCounted<AsyncTaskPQ<CopyCounted, CopyCounted, int>> at;
+      at.execute(100);
+      while (!at.onCallbackLoop());
+      EXPECT_EQ(0, CopyCounted::nCopy.load());
+    }
+
+    TEST(Copy, get_NoCopy_takeResultMoves)
+    {
+      CopyCounted::nCopy = 0;
+      AsyncTaskCopyCounted<AsyncTaskPQ<CopyCounted, CopyCounted, int>> at;
+      at.execute(1);
+      EXPECT_EQ(1, at.get().value);
+      EXPECT_EQ(1, at.takeResult().value);
+      EXPECT_EQ(0, CopyCounted::nCopy.load());
+    }
+  }
+
+  namespace Notification
+  {
+    class AsyncTaskGated : public AsyncTask<int, int, int>
+    {
+    public:
+      std::atomic_bool isReleased = false;
+
+    protected:
+      int doInBackground(int const& n) override
+      {
+        for (int i = 0; i < n; ++i)
+          publishProgress(i);
+
+        while (!isReleased && !isCancelled())
+          Wait(std::chrono::milliseconds(1));
+
+        return n;
+      }
+    };
+
+    TEST(Notification, waitForUpdate_NoProgress_Timeout)
+    {
+      AsyncTaskGated at;
+      at.execute(0);
+      EXPECT_FALSE(at.waitForUpdate(std::chrono::milliseconds(20)));
+      at.isReleased = true;
+    }
+
+    TEST(Notification, waitForUpdate_Progress_True)
+    {
+      AsyncTaskGated at;
+      at.execute(1);
+      EXPECT_TRUE(at.waitForUpdate(std::chrono::seconds(10)));
+      EXPECT_FALSE(at.onCallbackLoop());
+      at.isReleased = true;
+    }
+
+    TEST(Notification, waitForUpdate_Finished_onCallbackLoopTrue)
+    {
+      AsyncTaskGated at;
+      at.isReleased = true;
+      at.execute(0);
+      while (!at.onCallbackLoop())
+        at.waitForUpdate(std::chrono::seconds(10));
+
+      EXPECT_EQ(0, at.get());
+    }
+
+    TEST(Notification, waitForUpdate_Cancel_True)
+    {
+      AsyncTaskGated at;
+      at.execute(0);
+      EXPECT_FALSE(at.onCallbackLoop());
+      at.cancel();
+      EXPECT_TRUE(at.waitForUpdate(std::chrono::seconds(10)));
+    }
+
+    TEST(Notification, setWakeUpCallback_InvokedOnceUntilonCallbackLoop)
+    {
+      std::atomic<int> nWakeUp = 0;
+      AsyncTaskGated at;
+      at.setWakeUpCallback([&] { ++nWakeUp; });
+      at.execute(10);
+      while (nWakeUp == 0)
+        Wait(std::chrono::milliseconds(1));
+
+      Wait();
+      EXPECT_EQ(1, nWakeUp.load());
+
+      at.onCallbackLoop();
+      at.isReleased = true;
+      while (!at.onCallbackLoop())
+        at.waitForUpdate(std::chrono::seconds(10));
+
+      EXPECT_EQ(2, nWakeUp.load());
+    }
+
+    class AsyncTaskGatedLog : public AsyncTaskGated
+    {
+    public:
+      int nProgressUpdate = 0;
+
+    protected:
+      void onProgressUpdate(int const&) override { ++nProgressUpdate; }
+    };
+
+    TEST(Notification, hasNewProgress_onCallbackLoop_UnchangedProgressIsNotHandled)
+    {
+      AsyncTaskGatedLog at;
+      EXPECT_FALSE(at.hasNewProgress());
+
+      at.execute(1);
+      at.waitForUpdate(std::chrono::seconds(10));
+      EXPECT_TRUE(at.hasNewProgress());
+
+      for (int i = 0; i < 5; ++i)
+        at.onCallbackLoop();
+
+      EXPECT_FALSE(at.hasNewProgress());
+      EXPECT_EQ(1, at.nProgressUpdate);
+      at.isReleased = true;
+    }
+  }
+
+  namespace ProgressStorage
+  {
+    struct ProgressImage
+    {
+      std::vector<int> pixels;
+
+      ProgressImage() = default;
+      ProgressImage(int i) : pixels(1000, i) {}
+    };
+  }
+}
+
+template<>
+struct AsyncTaskProgressStorageOf<AsyncTaskTest::ProgressStorage::ProgressImage>
+{
+  static AsyncTaskProgressStorage constexpr value = AsyncTaskProgressStorage::TripleBuffer;
+};
+
+namespace AsyncTaskTest
+{
+  namespace ProgressStorage
+  {
+    class AsyncTaskImage : public AsyncTask<ProgressImage, int, int>
+    {
+    public:
+      std::atomic_bool isReleased = false;
+      int iLatest = -1;
+      bool isTorn = false;
+
+    protected:
+      int doInBackground(int const& n) override
+      {
+        for (int i = 0; i < n; ++i)
+          publishProgress(ProgressImage(i));
+
+        while (!isReleased && !isCancelled())
+          Wait(std::chrono::milliseconds(1));
+
+        return n;
+      }
+
+      void onProgressUpdate(ProgressImage const& progress) override
+      {
+        isTorn |= std::any_of(progress.pixels.begin(), progress.pixels.end(), [&](int i) { return i != progress.pixels.front(); });
+        isTorn |= progress.pixels.front() < iLatest;
+        iLatest = progress.pixels.front();
+      }
+    };
+
+    struct ProgressLarge
+    {
+      int values[16] = {};
+    };
+
+    class AsyncTaskLarge : public AsyncTask<ProgressLarge, int, int>
+    {
+    public:
+      std::atomic_bool isReleased = false;
+      int iLatest = -1;
+      bool isTorn = false;
+
+    protected:
+      int doInBackground(int const& n) override
+      {
+        for (int i = 0; i < n; ++i)
+        {
+          auto progress = ProgressLarge{};
+          std::fill(std::begin(progress.values), std::end(progress.values), i);
+          publishProgress(progress);
+        }
+
+        while (!isReleased && !isCancelled())
+          Wait(std::chrono::milliseconds(1));
+
+        return n;
+      }
+
+      void onProgressUpdate(ProgressLarge const& progress) override
+      {
+        isTorn |= std::any_of(std::begin(progress.values), std::end(progress.values), [&](int i) { return i != progress.values[0]; });
+        iLatest = progress.values[0];
+      }
+    };
+
+    TEST(ProgressStorage, AsyncTaskProgressStorageOf_Default)
+    {
+      static_assert(AsyncTask<int, int>::progressStorage == AsyncTaskProgressStorage::Atomic);
+      static_assert(AsyncTask<ProgressLarge, int>::progressStorage == AsyncTaskProgressStorage::SeqLock);
+      static_assert(AsyncTask<std::vector<int>, int>::progressStorage == AsyncTaskProgressStorage::Mutex);
+      static_assert(AsyncTaskImage::progressStorage == AsyncTaskProgressStorage::TripleBuffer);
+    }
+
+    TEST(ProgressStorage, TripleBuffer_LatestCompleteProgressIsHandled)
+    {
+      AsyncTaskImage at;
+      at.execute(10000);
+      while (at.iLatest < 9999)
+        if (!at.onCallbackLoop())
+          at.waitForUpdate(std::chrono::seconds(10));
+
+      at.isReleased = true;
+      EXPECT_EQ(10000, at.get());
+      EXPECT_FALSE(at.isTorn);
+    }
+
+    TEST(ProgressStorage, SeqLock_NoTornProgress)
+    {
+      AsyncTaskLarge at;
+      at.execute(100000);
+      while (at.iLatest < 99999)
+        if (!at.onCallbackLoop())
+          at.waitForUpdate(std::chrono::seconds(10));
+
+      at.isReleased = true;
+      EXPECT_EQ(100000, at.get());
+      EXPECT_FALSE(at.isTorn);
+    }
+  }
+
+  namespace Group
+  {
+    class AsyncTaskRow : public AsyncTask<int, int, int>
+    {
+    public:
+      int nProgressUpdate = 0;
+      bool isPostExecuted = false;
+
+      using AsyncTask<int, int, int>::AsyncTask;
+
+    protected:
+      int doInBackground(int const& i) override
+      {
+        if (i < 0)
+          throw i;
+
+        for (int j = 0; j < 10 && !isCancelled(); ++j)
+        {
+          publishProgress(j);
+          if (i == 0) // Long running
+            Wait();
+        }
+
+        return i;
+      }
+
+      void onProgressUpdate(int const&) override { ++nProgressUpdate; }
+      void onPostExecute(int const&) override { isPostExecuted = true; }
+    };
+
+    TEST(Group, whenAll_ManyOwnedTasks_AllFinished)
+    {
+      AsyncTaskThreadPool pool(4);
+      AsyncTaskGroup group;
+      std::vector<AsyncTaskRow*> tasks;
+      for (int i = 1; i <= 200; ++i)
+        tasks.push_back(&group.add(std::make_unique<AsyncTaskRow>(pool)));
+
+      for (int i = 1; i <= 200; ++i)
+        tasks[i - 1]->execute(i);
+
+      group.whenAll();
+      EXPECT_EQ(200u, group.getFinishedCount());
+      for (int i = 1; i <= 200; ++i)
+      {
+        EXPECT_TRUE(tasks[i - 1]->isPostExecuted);
+        EXPECT_EQ(i, tasks[i - 1]->get());
+      }
+    }
+
+    TEST(Group, whenAny_FastTaskFirst)
+    {
+      AsyncTaskRow atSlow, atFast;
+      AsyncTaskGroup group;
+      group.add(atSlow).execute(0);
+      group.add(atFast).execute(1);
+
+      EXPECT_EQ(std::optional<size_t>(1), group.whenAny());
+      group.cancelAll();
+      EXPECT_EQ(std::optional<size_t>(0), group.whenAny());
+      EXPECT_EQ(std::nullopt, group.whenAny());
+    }
+
+    TEST(Group, add_RunningTask_ThrowException)
+    {
+      AsyncTaskRow at;
+      AsyncTaskGroup group;
+      at.execute(1);
+      EXPECT_THROW(group.add(at), AsyncTaskIllegalStateException);
+    }
+
+    TEST(Group, onCallbackLoop_Exception_Rethrow)
+    {
+      AsyncTaskRow at1, at2;
+      AsyncTaskGroup group;
+      group.add(at1).execute(1);
+      group.add(at2).execute(-1);
+
+      auto isThrown = false;
+      try
+      {
+        group.whenAll();
+      }
+      catch (int e)
+      {
+        isThrown = true;
+        EXPECT_EQ(-1, e);
+      }
+      EXPECT_TRUE(isThrown);
+      EXPECT_TRUE(group.whenAll(std::chrono::seconds(10)));
+    }
+
+    TEST(Group, Dtor_RunningReferencedTasks_CancelledAndWaited)
+    {
+      AsyncTaskRow at1, at2;
+      {
+        AsyncTaskGroup group;
+        group.add(at1).execute(0);
+        group.add(at2);
+      }
+      EXPECT_TRUE(at1.isCancelled());
+      EXPECT_EQ(AsyncTaskRow::Status::FINISHED, at1.getStatus());
+    }
+
+    TEST(Group, add_TaskWithWakeUpCallback_BothAreInvoked)
+    {
+      std::atomic<int> nWakeUpOfTask = { 0 }, nWakeUpOfGroup = { 0 };
+      AsyncTaskRow at;
+      at.setWakeUpCallback([&] { ++nWakeUpOfTask; });
+
+      AsyncTaskGroup group;
+      group.setWakeUpCallback([&] { ++nWakeUpOfGroup; });
+      group.add(at).execute(1);
+      group.whenAll();
+
+      EXPECT_TRUE(at.isPostExecuted);
+      EXPECT_GT(nWakeUpOfTask.load(), 0);
+      EXPECT_GT(nWakeUpOfGroup.load(), 0);
+    }
+
+    TEST(Group, Dtor_ReferencedTaskRunsAgain_OwnWakeUpCallbackIsRestored)
+    {
+      std::atomic<int> nWakeUpOfTask = { 0 };
+      AsyncTaskRow at;
+      at.setWakeUpCallback([&] { ++nWakeUpOfTask; });
+      {
+        AsyncTaskGroup group;
+        group.add(at).execute(1);
+        group.whenAll();
+      }
+
+      nWakeUpOfTask.store(0);
+      at.reset();
+      at.execute(2);
+      while (!at.onCallbackLoop())
+        at.waitForUpdate(std::chrono::milliseconds(10));
+
+      EXPECT_EQ(2, at.get());
+      EXPECT_GT(nWakeUpOfTask.load(), 0);
+    }
+  }
+  namespace Continuation
+  {
+    class AsyncTaskStage : public AsyncTask<int, int, int>
+    {
+    public:
+      int nDoInBackground = 0;
+      bool isPreExecuted = false;
+      bool isPostExecuted = false;
+      bool isCancelledInvoked = false;
+      bool isLongRunning = false;
+
+      using AsyncTask<int, int, int>::AsyncTask;
+
+    protected:
+      int doInBackground(int const& i) override
+      {
+        ++nDoInBackground;
+        if (i < 0)
+          throw i;
+
+        while (isLongRunning && !isCancelled())
+          Wait(std::chrono::milliseconds(1));
+
+        return i * 2;
+      }
+
+      void onPreExecute() override { isPreExecuted = true; }
+      void onPostExecute(int const&) override { isPostExecuted = true; }
+      void onCancelled() override { isCancelledInvoked = true; }
+    };
+
+    class AsyncTaskToString : public AsyncTask<int, std::string, int>
+    {
+    protected:
+      std::string doInBackground(int const& i) override { return std::to_string(i); }
+    };
+
+    TEST(Continuation, then_ResultIsPassedToTheNext)
+    {
+      AsyncTaskStage at1, at2;
+      AsyncTaskToString at3;
+      at1.then(at2).then(at3);
+      EXPECT_EQ(AsyncTaskStage::Status::PENDING, at2.getStatus());
+
+      at1.execute(3);
+      EXPECT_TRUE(at2.isPreExecuted);
+      EXPECT_EQ(AsyncTaskStage::Status::RUNNING, at2.getStatus());
+
+      EXPECT_EQ("12", at3.get());
+      EXPECT_EQ(6, at1.get());
+      EXPECT_EQ(12, at2.get());
+      EXPECT_TRUE(at2.isPostExecuted);
+    }
+
+    TEST(Continuation, then_ThreadPool_onCallbackLoopOfTheLast)
+    {
+      AsyncTaskThreadPool pool(2);
+      AsyncTaskStage at1(pool), at2(pool), at3(pool);
+      at1.then(at2).then(at3);
+      at1.execute(1);
+      while (!at3.onCallbackLoop())
+        at3.waitForUpdate(std::chrono::seconds(10));
+
+      EXPECT_EQ(8, at3.get());
+      EXPECT_EQ(1, at3.nDoInBackground);
+    }
+
+    TEST(Continuation, then_CancelledPrevious_NextIsCancelledWithoutRun)
+    {
+      AsyncTaskStage at1, at2;
+      at1.isLongRunning = true;
+      at1.then(at2);
+      at1.execute(1);
+      at1.cancel();
+
+      at2.get();
+      EXPECT_TRUE(at2.isCancelled());
+      EXPECT_TRUE(at2.isCancelledInvoked);
+      EXPECT_FALSE(at2.isPostExecuted);
+      EXPECT_EQ(0, at2.nDoInBackground);
+    }
+
+    TEST(Continuation, then_ExceptionInPrevious_RethrownByTheLast)
+    {
+      AsyncTaskStage at1, at2, at3;
+      at1.then(at2).then(at3);
+      at1.execute(-1);
+
+      auto isThrown = false;
+      try
+      {
+        at3.get();
+      }
+      catch (int e)
+      {
+        isThrown = true;
+        EXPECT_EQ(-1, e);
+      }
+      EXPECT_TRUE(isThrown);
+      EXPECT_EQ(0, at2.nDoInBackground);
+      EXPECT_EQ(0, at3.nDoInBackground);
+    }
+
+    TEST(Continuation, then_AlreadyChained_Throws)
+    {
+      AsyncTaskStage at1, at2, at3;
+      at1.then(at2);
+
+      auto nThrown = 0;
+      try { at1.then(at3); }
+      catch (AsyncTaskIllegalStateException const& e) { ++nThrown; EXPECT_EQ(AsyncTaskIllegalStateException::eEx::TaskIsAlreadyChained, e.e); }
+
+      try { at3.then(at2); }
+      catch (AsyncTaskIllegalStateException const& e) { ++nThrown; EXPECT_EQ(AsyncTaskIllegalStateException::eEx::TaskIsAlreadyChained, e.e); }
+
+      try { at2.execute(1); }
+      catch (AsyncTaskIllegalStateException const& e) { ++nThrown; EXPECT_EQ(AsyncTaskIllegalStateException::eEx::TaskIsAlreadyChained, e.e); }
+
+      EXPECT_EQ(3, nThrown);
+    }
+
+    TEST(Continuation, Dtor_RunningPrevious_NextIsFinished)
+    {
+      AsyncTaskStage at2;
+      {
+        AsyncTaskStage at1;
+        at1.isLongRunning = true;
+        at1.then(at2);
+        at1.execute(1);
+      }
+      EXPECT_TRUE(at2.onCallbackLoop());
+      EXPECT_TRUE(at2.isCancelled());
+    }
+  }
+  namespace Reset
+  {
+    template<typename AsyncTaskT>
+    class AsyncTaskCounter : public AsyncTaskT
+    {
+    public:
+      std::vector<int> vProgress;
+      int nCancelled = 0;
+
+      using AsyncTaskT::AsyncTaskT;
+
+    protected:
+      int doInBackground(int const& n) override
+      {
+        if (n < 0)
+          throw n;
+
+        for (int i = 0; i < n; ++i)
+          this->publishProgress(i);
+
+        return n;
+      }
+
+      void onProgressUpdate(int const& progress) override { vProgress.push_back(progress); }
+      void onCancelled() override { ++nCancelled; }
+
+    public:
+      void handleProgressLeft() { this->handleProgress(); }
+    };
+
+    TEST(Reset, AsyncTask_ExecuteAgain)
+    {
+      AsyncTaskCounter<AsyncTask<int, int, int>> at;
+      at.execute(10);
+      EXPECT_EQ(10, at.get());
+
+      at.reset();
+      EXPECT_EQ(decltype(at)::Status::PENDING, at.getStatus());
+      EXPECT_FALSE(at.hasNewProgress());
+      at.execute(20);
+      while (!at.onCallbackLoop());
+      EXPECT_EQ(20, at.get());
+    }
+
+    TEST(Reset, AsyncTaskPQRingBuffer_UnhandledProgressIsDropped)
+    {
+      AsyncTaskCounter<AsyncTaskPQRingBuffer<4, AsyncTaskOverflowPolicy::DropOldest, int, int, int>> at;
+      at.execute(10);
+      EXPECT_EQ(10, at.get()); // progress is not handled
+
+      at.reset();
+      at.handleProgressLeft();
+      EXPECT_TRUE(at.vProgress.empty());
+
+      at.execute(3);
+      EXPECT_EQ(3, at.get());
+      at.handleProgressLeft();
+      EXPECT_EQ(std::vector<int>({ 0, 1, 2 }), at.vProgress);
+    }
+
+    TEST(Reset, AsyncTaskPQ_AfterExceptionAndCancel_Clean)
+    {
+      AsyncTaskCounter<AsyncTaskPQ<int, int, int>> at;
+      at.execute(-1);
+      try { at.get(); }
+      catch (int) {}
+
+      at.reset();
+      EXPECT_FALSE(at.isCancelled());
+      at.execute(2);
+      EXPECT_EQ(2, at.get());
+      at.handleProgressLeft();
+      EXPECT_EQ(std::vector<int>({ 0, 1 }), at.vProgress);
+      EXPECT_EQ(1, at.nCancelled);
+    }
+
+    TEST(Reset, Running_Throws)
+    {
+      AsyncTaskCounter<AsyncTask<int, int, int>> at;
+      at.execute(1000);
+
+      auto isThrown = false;
+      try
+      {
+        at.reset();
+      }
+      catch (AsyncTaskIllegalStateException const& e)
+      {
+        isThrown = true;
+        EXPECT_EQ(AsyncTaskIllegalStateException::eEx::TaskIsAlreadyRunning, e.e);
+      }
+      EXPECT_TRUE(isThrown);
+    }
+
+    TEST(Reset, ChainIsRebuilt)
+    {
+      AsyncTaskCounter<AsyncTask<int, int, int>> at1, at2;
+      at1.then(at2);
+      at1.execute(1);
+      EXPECT_EQ(1, at2.get());
+      EXPECT_EQ(1, at1.get());
+
+      at1.reset();
+      at2.reset();
+      at2.execute(5);
+      EXPECT_EQ(5, at2.get());
+    }
+  }
+
+  namespace MemoryResource
+  {
+    class CountingResource : public std::pmr::memory_resource
+    {
+    public:
+      std::atomic<int> nAllocation = 0;
+      std::atomic<int> nAllocationLive = 0;
+
+    private:
+      void* do_allocate(size_t bytes, size_t alignment) override
+      {
+        ++nAllocation;
+        ++nAllocationLive;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+      }
+
+      void do_deallocate(void* p, size_t bytes, size_t alignment) override
+      {
+        --nAllocationLive;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+      }
+
+      bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override { return this == &other; }
+    };
+
+    template<typename AsyncTaskT>
+    class AsyncTaskPublisher : public AsyncTaskT
+    {
+    public:
+      using AsyncTaskT::AsyncTaskT;
+
+    protected:
+      int doInBackground(int const& n) override
+      {
+        for (int i = 0; i < n; ++i)
+          this->publishProgress(i);
+
+        return n;
+      }
+    };
+
+    TEST(MemoryResource, AsyncTask_SharedStateFromTheResource)
+    {
+      CountingResource resource;
+      {
+        AsyncTaskPublisher<AsyncTask<int, int, int>> at(resource);
+        EXPECT_EQ(&resource, &at.getMemoryResource());
+        at.execute(10);
+        EXPECT_EQ(10, at.get());
+        EXPECT_GT(resource.nAllocation.load(), 0);
+      }
+      EXPECT_EQ(0, resource.nAllocationLive.load());
+    }
+
+    TEST(MemoryResource, AsyncTaskPQ_QueueNodesFromTheResource)
+    {
+      CountingResource resource;
+      {
+        AsyncTaskThreadPool pool(2, resource);
+        AsyncTaskPublisher<AsyncTaskPQ<int, int, int>> at(pool, resource);
+        at.execute(10000);
+        while (!at.onCallbackLoop());
+        EXPECT_GT(resource.nAllocation.load(), 1);
+      }
+      EXPECT_EQ(0, resource.nAllocationLive.load());
+    }
+  }
+
+  namespace Scheduling
+  {
+    class AsyncTaskBlocker : public AsyncTask<int, int, int>
+    {
+    public:
+      std::atomic_bool isStarted = false;
+      std::atomic_bool isReleased = false;
+
+      using AsyncTask<int, int, int>::AsyncTask;
+
+    protected:
+      int doInBackground(int const& i) override
+      {
+        isStarted = true;
+        while (!isReleased)
+          Wait(std::chrono::milliseconds(1));
+
+        return i;
+      }
+    };
+
+    class AsyncTaskRecorder : public AsyncTask<int, int, int>
+    {
+    public:
+      std::mutex* mutexOrder = nullptr;
+      std::vector<int>* vOrder = nullptr;
+      bool isRun = false;
+
+      using AsyncTask<int, int, int>::AsyncTask;
+
+    protected:
+      int doInBackground(int const& i) override
+      {
+        isRun = true;
+        if (vOrder)
+        {
+          std::unique_lock<std::mutex> lock(*mutexOrder);
+          vOrder->push_back(i);
+        }
+        return i;
+      }
+    };
+
+    TEST(Scheduling, ThreadPool_InteractiveJumpsAhead)
+    {
+      std::mutex mutexOrder;
+      std::vector<int> vOrder;
+
+      AsyncTaskThreadPool pool(1);
+      AsyncTaskBlocker atBlocker(pool);
+      atBlocker.execute(0);
+      while (!atBlocker.isStarted)
+        Wait(std::chrono::milliseconds(1));
+
+      std::vector<std::unique_ptr<AsyncTaskRecorder>> tasks;
+      auto const fnExecute = [&](AsyncTaskPriority priority, int i)
+      {
+        auto& task = *tasks.emplace_back(std::make_unique<AsyncTaskRecorder>(pool));
+        task.mutexOrder = &mutexOrder;
+        task.vOrder = &vOrder;
+        task.execute(AsyncTaskLaunchOptions{ priority, std::nullopt }, i);
+      };
+
+      fnExecute(AsyncTaskPriority::Background, 0);
+      fnExecute(AsyncTaskPriority::Background, 1);
+      fnExecute(AsyncTaskPriority::Normal, 2);
+      fnExecute(AsyncTaskPriority::Interactive, 3);
+      fnExecute(AsyncTaskPriority::Interactive, 4);
+
+      atBlocker.isReleased = true;
+      for (auto& task : tasks)
+        task->get();
+
+      EXPECT_EQ(std::vector<int>({ 3, 4, 2, 0, 1 }), vOrder);
+    }
+
+    TEST(Scheduling, Deadline_Missed_CancelledWithoutRun)
+    {
+      AsyncTaskThreadPool pool(1);
+      AsyncTaskBlocker atBlocker(pool);
+      atBlocker.execute(0);
+
+      AsyncTaskRecorder at(pool);
+      at.execute(AsyncTaskLaunchOptions{ AsyncTaskPriority::Normal, std::chrono::steady_clock::now() + std::chrono::milliseconds(1) }, 1);
+      Wait(std::chrono::milliseconds(20));
+      atBlocker.isReleased = true;
+
+      at.get();
+      EXPECT_TRUE(at.isCancelled());
+      EXPECT_FALSE(at.isRun);
+    }
+
+    TEST(Scheduling, Deadline_NotMissed_Run)
+    {
+      AsyncTaskRecorder at;
+      at.execute(AsyncTaskLaunchOptions{ AsyncTaskPriority::Interactive, std::chrono::steady_clock::now() + std::chrono::seconds(60) }, 1);
+      EXPECT_EQ(1, at.get());
+      EXPECT_FALSE(at.isCancelled());
+      EXPECT_TRUE(at.isRun);
+    }
+  }
+
+  namespace Cancellation
+  {
+    class AsyncTaskSleeper : public AsyncTask<int, bool, int>
+    {
+    protected:
+      bool doInBackground(int const& seconds) override
+      {
+        return getCancellationToken().waitFor(std::chrono::seconds(seconds));
+      }
+    };
+
+    class AsyncTaskConditionWaiter : public AsyncTask<int, int, int>
+    {
+    public:
+      std::atomic_bool isWaiting = false;
+
+    protected:
+      int doInBackground(int const&) override
+      {
+        std::mutex mutex;
+        std::condition_variable condition;
+        AsyncTaskCancelCallback callback(getCancellationToken(), [&] { std::unique_lock<std::mutex> lock(mutex); condition.notify_all(); });
+
+        std::unique_lock<std::mutex> lock(mutex);
+        isWaiting = true;
+        condition.wait(lock, [this] { return isCancelled(); });
+        return 1;
+      }
+    };
+
+    TEST(Cancellation, waitFor_Cancel_ReturnsEarly)
+    {
+      AsyncTaskSleeper at;
+      auto const begin = std::chrono::steady_clock::now();
+      at.execute(60);
+      Wait();
+      at.cancel();
+      at.get();
+      EXPECT_LT(std::chrono::steady_clock::now() - begin, std::chrono::seconds(30));
+    }
+
+    TEST(Cancellation, waitFor_NoCancel_False)
+    {
+      AsyncTaskSleeper at;
+      at.execute(0);
+      EXPECT_FALSE(at.get());
+    }
+
+    TEST(Cancellation, Dtor_BlockedInSleep_NoDelay)
+    {
+      auto const begin = std::chrono::steady_clock::now();
+      {
+        AsyncTaskSleeper at;
+        at.execute(60);
+        Wait();
+      }
+      EXPECT_LT(std::chrono::steady_clock::now() - begin, std::chrono::seconds(30));
+    }
+
+    TEST(Cancellation, AsyncTaskCancelCallback_InterruptsConditionWait)
+    {
+      AsyncTaskConditionWaiter at;
+      at.execute(0);
+      while (!at.isWaiting)
+        Wait(std::chrono::milliseconds(1));
+
+      at.cancel();
+      while (!at.onCallbackLoop())
+        at.waitForUpdate(std::chrono::seconds(10));
+
+      EXPECT_TRUE(at.isCancelled());
+    }
+
+    TEST(Cancellation, AsyncTaskCancelCallback_Registration)
+    {
+      AsyncTaskCancellationState state;
+      auto const token = AsyncTaskCancellationToken(state);
+      int nInvoked = 0;
+      {
+        AsyncTaskCancelCallback callbackDeregistered(token, [&] { nInvoked += 100; });
+      }
+
+      AsyncTaskCancelCallback callback(token, [&] { ++nInvoked; });
+      EXPECT_TRUE(state.cancel());
+      EXPECT_FALSE(state.cancel());
+      EXPECT_EQ(1, nInvoked);
+      EXPECT_TRUE(token.isCancelled());
+
+      AsyncTaskCancelCallback callbackLate(token, [&] { ++nInvoked; }); // Invoked immediately
+      EXPECT_EQ(2, nInvoked);
+      EXPECT_TRUE(token.waitFor(std::chrono::seconds(60)));
+      EXPECT_FALSE(AsyncTaskCancellationToken().isCancelled());
+    }
+  }
+
+  namespace ParallelFor
+  {
+    struct ParallelResult
+    {
+      bool isCompleted = false;
+      std::vector<int> vVisit;
+      std::vector<size_t> vReported;
+      bool isReportedOnCaller = true;
+      bool isHelperOnDefaultPool = true;
+    };
+
+    class AsyncTaskSquares : public AsyncTask<size_t, ParallelResult, size_t>
+    {
+    public:
+      size_t nThrowAt = std::numeric_limits<size_t>::max();
+      std::chrono::milliseconds tStep = std::chrono::milliseconds(0);
+
+      using AsyncTask<size_t, ParallelResult, size_t>::AsyncTask;
+
+    protected:
+      ParallelResult doInBackground(size_t const& n) override
+      {
+        auto result = ParallelResult{};
+        auto vVisit = std::vector<std::atomic<int>>(n);
+        auto const idCaller = std::this_thread::get_id();
+        auto isHelperOnDefaultPool = std::atomic<bool>{ true };
+        result.isCompleted = parallelFor(0, n, 7
+          , [&](size_t i)
+          {
+            if (i == nThrowAt)
+              throw static_cast<int>(i);
+
+            if (idCaller != std::this_thread::get_id() && !AsyncTaskThreadPool::getDefault().getCurrentCore())
+              isHelperOnDefaultPool.store(false);
+
+            if (tStep.count() > 0)
+              Wait(tStep);
+
+            ++vVisit[i];
+          }
+          , [&](size_t nDone, size_t nTotal)
+          {
+            EXPECT_EQ(n, nTotal);
+            result.isReportedOnCaller &= idCaller == std::this_thread::get_id();
+            result.vReported.push_back(nDone);
+            publishProgress(nDone);
+          });
+
+        for (auto const& visit : vVisit)
+          result.vVisit.push_back(visit.load());
+
+        result.isHelperOnDefaultPool = isHelperOnDefaultPool.load();
+        return result;
+      }
+    };
+
+    TEST(ParallelFor, ThreadPool_EveryIndexOnce_ProgressAggregated)
+    {
+      AsyncTaskThreadPool pool(4);
+      AsyncTaskSquares at(pool);
+      at.execute(10000);
+      auto const& result = at.get();
+
+      EXPECT_TRUE(result.isCompleted);
+      EXPECT_EQ(std::vector<int>(10000, 1), result.vVisit);
+      ASSERT_FALSE(result.vReported.empty());
+      EXPECT_EQ(10000, result.vReported.back());
+      EXPECT_TRUE(std::is_sorted(result.vReported.begin(), result.vReported.end()));
+      EXPECT_TRUE(result.isReportedOnCaller);
+    }
+
+    TEST(ParallelFor, ThreadExecutor_EveryIndexOnce)
+    {
+      AsyncTaskSquares at;
+      at.execute(1000);
+      auto const& result = at.get();
+
+      EXPECT_TRUE(result.isCompleted);
+      EXPECT_EQ(std::vector<int>(1000, 1), result.vVisit);
+    }
+
+    TEST(ParallelFor, ThreadExecutor_HelpersRunOnTheDefaultPool)
+    {
+      for (int i = 0; i < 3; ++i) // Every call reuses the workers of the default pool
+      {
+        AsyncTaskSquares at;
+        at.tStep = std::chrono::milliseconds(1);
+        at.execute(100);
+        auto const& result = at.get();
+
+        EXPECT_TRUE(result.isCompleted);
+        EXPECT_EQ(std::vector<int>(100, 1), result.vVisit);
+        EXPECT_TRUE(result.isHelperOnDefaultPool);
+      }
+    }
+
+    TEST(ParallelFor, Cancel_StoppedPromptly)
+    {
+      AsyncTaskThreadPool pool(4);
+      AsyncTaskSquares at(pool);
+      at.tStep = std::chrono::milliseconds(1);
+      at.execute(100000);
+      Wait(std::chrono::milliseconds(20));
+
+      auto const begin = std::chrono::steady_clock::now();
+      at.cancel();
+      at.get();
+      EXPECT_LT(std::chrono::steady_clock::now() - begin, std::chrono::seconds(5));
+    }
+
+    TEST(ParallelFor, Exception_Rethrown)
+    {
+      AsyncTaskThreadPool pool(4);
+      AsyncTaskSquares at(pool);
+      at.nThrowAt = 500;
+      at.execute(10000);
+
+      auto isThrown = false;
+      try
+      {
+        at.get();
+      }
+      catch (int e)
+      {
+        isThrown = true;
+        EXPECT_EQ(500, e);
+      }
+      EXPECT_TRUE(isThrown);
+    }
+  }
+
+  namespace Static
+  {
+    class AsyncTaskCounter final : public AsyncTaskStatic<int, int, int>
+    {
+    public:
+      std::vector<int> vProgress;
+
+    protected:
+      int doInBackground(int const& n) override
+      {
+        for (int i = 0; i < n && !isCancelled(); ++i)
+          publishProgress(i);
+
+        return n;
+      }
+
+      void onProgressUpdate(int const& progress) override { vProgress.push_back(progress); }
+
+    public:
+      void handleProgressLeft() { this->handleProgress(); }
+    };
+
+    TEST(Static, publishProgress_LatestIsHandled)
+    {
+      AsyncTaskCounter at;
+      at.execute(100000);
+      while (!at.onCallbackLoop());
+      at.handleProgressLeft();
+
+      EXPECT_EQ(100000, at.get());
+      ASSERT_FALSE(at.vProgress.empty());
+      EXPECT_EQ(99999, at.vProgress.back());
+      EXPECT_TRUE(std::is_sorted(at.vProgress.begin(), at.vProgress.end()));
+    }
+
+    TEST(Static, publishProgress_Throttled_FinalValueIsHandled)
+    {
+      AsyncTaskCounter at;
+      at.setProgressThrottle({ std::chrono::hours(1) });
+      at.execute(1000);
+      at.get();
+      at.handleProgressLeft();
+      EXPECT_EQ(std::vector<int>({ 999 }), at.vProgress);
+    }
+
+    TEST(Static, publishProgressRvalue_NoCopyAtStore)
+    {
+      Copy::CopyCounted::nCopy = 0;
+      Copy::AsyncTaskCopyCounted<AsyncTaskStatic<Copy::CopyCounted, Copy::CopyCounted, int>> at;
+      at.execute(100);
+      at.get();
+      EXPECT_EQ(0, at.nCopyOfStore);
+    }
+  }
+
+  namespace Throttle
+  {
+    struct Percent
+    {
+      int iP = 0;
+      std::string szFeedback;
+
+      Percent(int iP) : iP(iP), szFeedback(std::to_string(iP)) {}
+    };
+
+    template<typename AsyncTaskT, typename ProgressT>
+    class AsyncTaskPublisher : public AsyncTaskT
+    {
+    public:
+      std::vector<ProgressT> vProgress;
+      bool isRvalue = false;
+
+      using AsyncTaskT::AsyncTaskT;
+
+    protected:
+      int doInBackground(int const& n) override
+      {
+        for (int i = 0; i <= n; ++i)
+        {
+          auto progress = ProgressT{ i };
+          if (isRvalue)
+            this->publishProgress(std::move(progress));
+          else
+            this->publishProgress(progress);
+        }
+
+        return n;
+      }
+
+      void onProgressUpdate(ProgressT const& progress) override { vProgress.push_back(progress); }
+
+    public:
+      void handleProgressLeft() { this->handleProgress(); }
+    };
+
+    TEST(Throttle, Delta_ArithmeticProgress_ThresholdAndFinalValue)
+    {
+      AsyncTaskPublisher<AsyncTaskPQ<int, int, int>, int> at;
+      at.setProgressThrottle({ {}, 100.0 });
+      at.execute(999);
+      EXPECT_EQ(999, at.get());
+      at.handleProgressLeft();
+      EXPECT_EQ(std::vector<int>({ 0, 100, 200, 300, 400, 500, 600, 700, 800, 900, 999 }), at.vProgress);
+    }
+
+    TEST(Throttle, Delta_Measure_RvalueFinalValue)
+    {
+      AsyncTaskPublisher<AsyncTaskPQ<Percent, int, int>, Percent> at;
+      at.isRvalue = true;
+      at.setProgressThrottle({ {}, 500.0, [](Percent const& p) { return double(p.iP); } });
+      at.execute(1200);
+      at.get();
+      at.handleProgressLeft();
+      ASSERT_EQ(4, at.vProgress.size());
+      EXPECT_EQ(500, at.vProgress[1].iP);
+      EXPECT_EQ(1200, at.vProgress.back().iP);
+    }
+
+    TEST(Throttle, Interval_OnlyFirstAndFinalAreStored)
+    {
+      AsyncTaskPublisher<AsyncTaskPQ<int, int, int>, int> at;
+      at.setProgressThrottle({ std::chrono::hours(1) });
+      at.execute(100000);
+      at.get();
+      at.handleProgressLeft();
+      EXPECT_EQ(std::vector<int>({ 0, 100000 }), at.vProgress);
+    }
+
+    TEST(Throttle, Disabled_EveryProgressIsStored)
+    {
+      AsyncTaskPublisher<AsyncTaskPQ<int, int, int>, int> at;
+      at.setProgressThrottle({ std::chrono::hours(1) });
+      at.setProgressThrottle({});
+      at.execute(99);
+      at.get();
+      at.handleProgressLeft();
+      EXPECT_EQ(100, at.vProgress.size());
+    }
+
+    TEST(Throttle, AsyncTask_FinalValueIsHandled_AfterReset)
+    {
+      AsyncTaskPublisher<AsyncTask<int, int, int>, int> at;
+      at.setProgressThrottle({ std::chrono::hours(1) });
+      at.execute(1000);
+      at.get();
+      at.handleProgressLeft();
+      ASSERT_FALSE(at.vProgress.empty());
+      EXPECT_EQ(1000, at.vProgress.back());
+
+      at.reset();
+      at.vProgress.clear();
+      at.execute(10);
+      at.get();
+      at.handleProgressLeft();
+      EXPECT_EQ(std::vector<int>({ 10 }), at.vProgress); // first one is stored again, only the latest is handled
+    }
+  }
+
+  namespace Stats
+  {
+    using AsyncTaskPublisherPQ = Throttle::AsyncTaskPublisher<AsyncTaskPQ<int, int, int>, int>;
+
+    class AsyncTaskSummed : public AsyncTaskPublisherPQ
+    {
+    protected:
+      std::optional<int> isLastShouldBeAltered(int const& progressOld, int const& progressNew) const override { return progressOld + progressNew; }
+    };
+
+    struct TraceSinkLog : AsyncTaskTraceSink
+    {
+      std::vector<std::pair<void const*, AsyncTaskStats>> vFinished;
+
+      void onTaskFinished(void const* task, AsyncTaskStats const& stats) noexcept override { vFinished.emplace_back(task, stats); }
+    };
+
+    TEST(Stats, Disabled_NoStats)
+    {
+      AsyncTaskPublisherPQ at;
+      at.execute(10);
+      at.get();
+      EXPECT_FALSE(at.getStats().has_value());
+    }
+
+    TEST(Stats, AsyncTaskPQ_TimestampsAndCounters)
+    {
+      AsyncTaskPublisherPQ at;
+      at.enableStats();
+      at.execute(99);
+      at.get();
+
+      auto const stats = at.getStats();
+      ASSERT_TRUE(stats.has_value());
+      EXPECT_NE(AsyncTaskStats::Clock::time_point{}, stats->tExecute);
+      EXPECT_LE(stats->tExecute, stats->tStart);
+      EXPECT_LE(stats->tStart, stats->tFinish);
+      EXPECT_LE(stats->tFinish, stats->tDispatch);
+      EXPECT_GE(stats->getWaitTime().count(), 0);
+      EXPECT_EQ(100, stats->nPublished);
+      EXPECT_EQ(100, stats->nStored);
+      EXPECT_EQ(0, stats->nThrottled);
+      EXPECT_EQ(0, stats->nCoalesced);
+      EXPECT_EQ(0, stats->nDropped);
+      EXPECT_GE(stats->nQueueHighWater, 1);
+      EXPECT_LE(stats->nQueueHighWater, 100);
+    }
+
+    TEST(Stats, AsyncTaskPQ_Coalesced)
+    {
+      AsyncTaskSummed at;
+      at.enableStats();
+      at.execute(99);
+      at.get();
+
+      auto const stats = at.getStats();
+      EXPECT_EQ(100, stats->nStored);
+      EXPECT_EQ(100 - stats->nQueueHighWater, stats->nCoalesced);
+    }
+
+    TEST(Stats, RingBuffer_DropOldest_Dropped)
+    {
+      Throttle::AsyncTaskPublisher<AsyncTaskPQRingBuffer<4, AsyncTaskOverflowPolicy::DropOldest, int, int, int>, int> at;
+      at.enableStats();
+      at.execute(9);
+      at.get(); // progress is not consumed
+
+      auto const stats = at.getStats();
+      EXPECT_EQ(10, stats->nStored);
+      EXPECT_EQ(6, stats->nDropped);
+      EXPECT_EQ(4, stats->nQueueHighWater);
+    }
+
+    TEST(Stats, Throttled_AndResetClears)
+    {
+      AsyncTaskPublisherPQ at;
+      at.enableStats();
+      at.setProgressThrottle({ std::chrono::hours(1) });
+      at.execute(99);
+      at.get();
+      EXPECT_EQ(100, at.getStats()->nPublished);
+      EXPECT_EQ(99, at.getStats()->nThrottled);
+      EXPECT_EQ(2, at.getStats()->nStored); // first and final
+
+      at.reset();
+      auto const stats = at.getStats();
+      ASSERT_TRUE(stats.has_value());
+      EXPECT_EQ(0, stats->nPublished);
+      EXPECT_EQ(AsyncTaskStats::Clock::time_point{}, stats->tExecute);
+    }
+
+    TEST(Stats, TraceSink_InvokedAtFinish)
+    {
+      TraceSinkLog sink;
+      AsyncTaskPublisherPQ at;
+      at.enableStats(&sink);
+      at.execute(9);
+      while (!at.onCallbackLoop());
+
+      ASSERT_EQ(1, sink.vFinished.size());
+      EXPECT_EQ(static_cast<void const*>(&at), sink.vFinished[0].first);
+      EXPECT_EQ(10, sink.vFinished[0].second.nPublished);
+      EXPECT_NE(AsyncTaskStats::Clock::time_point{}, sink.vFinished[0].second.tDispatch);
+    }
+
+    TEST(Stats, AsyncTaskChromeTraceSink_JsonEvents)
+    {
+      std::ostringstream out;
+      {
+        AsyncTaskChromeTraceSink sink(out);
+        AsyncTaskPublisherPQ at1, at2;
+        at1.enableStats(&sink);
+        at2.enableStats(&sink);
+        at1.execute(9);
+        at2.execute(9);
+        at1.get();
+        at2.get();
+      }
+
+      auto const json = out.str();
+      EXPECT_EQ('[', json.front());
+      EXPECT_EQ("]\n", json.substr(json.size() - 2));
+      EXPECT_NE(std::string::npos, json.find("{\"name\":\"queued\",\"ph\":\"X\""));
+      EXPECT_NE(std::string::npos, json.find("\"args\":{\"published\":10,"));
+
+      size_t nDispatch = 0;
+      for (auto pos = json.find("\"dispatch\""); pos != std::string::npos; pos = json.find("\"dispatch\"", pos + 1))
+        ++nDispatch;
+      EXPECT_EQ(2, nDispatch);
+    }
+  }
+
+  namespace Budget
+  {
+    template<typename AsyncTaskT>
+    class AsyncTaskBurst : public AsyncTaskT
+    {
+    public:
+      std::vector<int> vProgress;
+      bool isPostExecuted = false;
+      bool isProgressAfterPostExecute = false;
+
+    protected:
+      int doInBackground(int const& n) override
+      {
+        for (int i = 0; i < n; ++i)
+          this->publishProgress(i);
+
+        return n;
+      }
+
+      void onProgressUpdate(int const& progress) override
+      {
+        isProgressAfterPostExecute |= isPostExecuted;
+        vProgress.push_back(progress);
+      }
+
+      void onPostExecute(int const&) override { isPostExecuted = true; }
+    };
+
+    template<typename AsyncTaskT>
+    static void WaitForWorker(AsyncTaskT const& at, size_t nCallback)
+    {
+      while (at.getPendingCallbackCount() < nCallback)
+        Wait(std::chrono::milliseconds(1));
+    }
+
+    TEST(Budget, dispatchCallbacks_LeftoverIsCarriedOver_FinishIsLast)
+    {
+      AsyncTaskBurst<AsyncTaskPQ<int, int, int>> at;
+      at.execute(100);
+      WaitForWorker(at, 101);
+
+      for (int iPass = 1; iPass <= 3; ++iPass)
+      {
+        size_t nBudget = 30;
+        EXPECT_FALSE(at.dispatchCallbacks(nBudget));
+        EXPECT_EQ(0, nBudget);
+        EXPECT_EQ(size_t(30 * iPass), at.vProgress.size());
+        EXPECT_EQ(size_t(101 - 30 * iPass), at.getPendingCallbackCount());
+      }
+
+      size_t nBudget = 30;
+      EXPECT_TRUE(at.dispatchCallbacks(nBudget));
+      EXPECT_EQ(19, nBudget);
+      EXPECT_TRUE(at.isPostExecuted);
+      EXPECT_FALSE(at.isProgressAfterPostExecute);
+      for (int i = 0; i < 100; ++i)
+        ASSERT_EQ(i, at.vProgress[i]);
+    }
+
+    TEST(Budget, dispatchCallbacks_AsyncTask_LatestIsOneItem)
+    {
+      AsyncTaskBurst<AsyncTask<int, int, int>> at;
+      at.execute(100);
+      WaitForWorker(at, 2);
+
+      size_t nBudget = 1;
+      EXPECT_FALSE(at.dispatchCallbacks(nBudget));
+      EXPECT_EQ(std::vector<int>({ 99 }), at.vProgress);
+
+      nBudget = 1;
+      EXPECT_TRUE(at.dispatchCallbacks(nBudget));
+      EXPECT_EQ(0, at.getPendingCallbackCount());
+    }
+
+    TEST(Budget, Group_RoundRobinTurns)
+    {
+      AsyncTaskGroup group;
+      auto& at1 = group.add(std::make_unique<AsyncTaskBurst<AsyncTaskPQ<int, int, int>>>());
+      auto& at2 = group.add(std::make_unique<AsyncTaskBurst<AsyncTaskPQRingBuffer<128, AsyncTaskOverflowPolicy::Block, int, int, int>>>());
+      at1.execute(100);
+      at2.execute(100);
+      WaitForWorker(at1, 101);
+      WaitForWorker(at2, 101);
+      EXPECT_EQ(202, group.getPendingCount());
+
+      EXPECT_FALSE(group.onCallbackLoop(AsyncTaskCallbackBudget{ std::chrono::steady_clock::duration::max(), 20, 5 }));
+      EXPECT_EQ(10, at1.vProgress.size());
+      EXPECT_EQ(10, at2.vProgress.size());
+      EXPECT_EQ(182, group.getPendingCount());
+
+      EXPECT_TRUE(group.waitForUpdate(std::chrono::seconds(0))); // Leftover is pending
+      size_t nPass = 1;
+      while (!group.onCallbackLoop(AsyncTaskCallbackBudget{ std::chrono::steady_clock::duration::max(), 20, 5 }))
+        ++nPass;
+
+      EXPECT_EQ(10, nPass);
+      EXPECT_EQ(0, group.getPendingCount());
+      for (auto const* at : { &at1.vProgress, &at2.vProgress })
+      {
+        ASSERT_EQ(100, at->size());
+        for (int i = 0; i < 100; ++i)
+          ASSERT_EQ(i, (*at)[i]);
+      }
+      EXPECT_FALSE(at1.isProgressAfterPostExecute);
+      EXPECT_FALSE(at2.isProgressAfterPostExecute);
+    }
+
+    TEST(Budget, Group_TimeBudget_OneTurnIfExpired)
+    {
+      AsyncTaskGroup group;
+      auto& at1 = group.add(std::make_unique<AsyncTaskBurst<AsyncTaskPQ<int, int, int>>>());
+      auto& at2 = group.add(std::make_unique<AsyncTaskBurst<AsyncTaskPQ<int, int, int>>>());
+      at1.execute(100);
+      at2.execute(100);
+      WaitForWorker(at1, 101);
+      WaitForWorker(at2, 101);
+
+      group.onCallbackLoop(AsyncTaskCallbackBudget{ std::chrono::steady_clock::duration::zero(), 1000, 5 });
+      EXPECT_EQ(5, at1.vProgress.size() + at2.vProgress.size());
+    }
+
+    TEST(Budget, Group_LeftoverIsHandledByUnlimitedCallbackLoop)
+    {
+      AsyncTaskGroup group;
+      auto& at = group.add(std::make_unique<AsyncTaskBurst<AsyncTaskPQ<int, int, int>>>());
+      at.execute(100);
+      WaitForWorker(at, 101);
+
+      group.onCallbackLoop(AsyncTaskCallbackBudget{ std::chrono::steady_clock::duration::max(), 10, 5 });
+      EXPECT_EQ(10, at.vProgress.size());
+      group.whenAll();
+      EXPECT_EQ(100, at.vProgress.size());
+      EXPECT_TRUE(at.isPostExecuted);
+      EXPECT_FALSE(at.isProgressAfterPostExecute);
+    }
+  }
+
+  namespace Reduction
+  {
+    using Lines = std::vector<int>;
+
+    template<typename AsyncTaskT>
+    class AsyncTaskLog : public AsyncTaskT
+    {
+    public:
+      std::vector<Lines> vProgress;
+      std::chrono::milliseconds pause = {};
+      std::promise<void> release;
+
+    protected:
+      int doInBackground(int const& n) override
+      {
+        for (int i = 0; i < n; ++i)
+        {
+          if (i == n / 2 && pause > std::chrono::milliseconds::zero())
+            Wait(pause);
+
+          this->publishProgress(Lines{ i });
+        }
+
+        if (pause < std::chrono::milliseconds::zero())
+          this->release.get_future().wait();
+
+        return n;
+      }
+
+      Lines combine(Lines&& linesAccumulated, Lines&& linesNext) const override
+      {
+        linesAccumulated.insert(linesAccumulated.end(), linesNext.begin(), linesNext.end());
+        return std::move(linesAccumulated);
+      }
+
+      void onProgressUpdate(Lines const& lines) override { vProgress.push_back(lines); }
+    };
+
+    static Lines Iota(int begin, int end)
+    {
+      auto lines = Lines{};
+      for (int i = begin; i < end; ++i)
+        lines.push_back(i);
+
+      return lines;
+    }
+
+    template<typename AsyncTaskT>
+    static std::vector<Lines> RunReduced(AsyncTaskProgressReduction const& reduction, int n, std::chrono::milliseconds pause = {})
+    {
+      AsyncTaskLog<AsyncTaskT> at;
+      at.setProgressReduction(reduction);
+      at.pause = pause;
+      at.execute(n);
+      for (size_t nBudget = 1000; !at.dispatchCallbacks(nBudget); nBudget = 1000)
+        Wait(std::chrono::milliseconds(1));
+
+      EXPECT_EQ(n, at.get());
+      return at.vProgress;
+    }
+
+    using PQ = AsyncTaskPQ<Lines, int, int>;
+    using PQRingBuffer = AsyncTaskPQRingBuffer<4, AsyncTaskOverflowPolicy::Block, Lines, int, int>;
+
+    TEST(Reduction, MaxItems_ItemsAreMergedInOrder_RestIsFlushed)
+    {
+      auto const vExpected = std::vector<Lines>{ Iota(0, 10), Iota(10, 20), Iota(20, 25) };
+      EXPECT_EQ(vExpected, RunReduced<PQ>(AsyncTaskProgressReduction{ 10 }, 25));
+      EXPECT_EQ(vExpected, RunReduced<PQRingBuffer>(AsyncTaskProgressReduction{ 10 }, 25));
+    }
+
+    TEST(Reduction, Disabled_EveryItemIsQueued)
+    {
+      EXPECT_EQ(5, RunReduced<PQ>(AsyncTaskProgressReduction{}, 5).size());
+      EXPECT_EQ(5, RunReduced<PQ>(AsyncTaskProgressReduction{ 1, std::chrono::hours(1) }, 5).size());
+    }
+
+    TEST(Reduction, MaxInterval_ExpiredAccumulatorIsQueued)
+    {
+      auto const reduction = AsyncTaskProgressReduction{ 0, std::chrono::milliseconds(20) };
+      EXPECT_EQ(std::vector<Lines>({ Iota(0, 6) }), RunReduced<PQ>(reduction, 6));
+      EXPECT_EQ(std::vector<Lines>({ Iota(0, 4), Iota(4, 6) }), RunReduced<PQ>(reduction, 6, std::chrono::milliseconds(40))); // Pause before the 4th
+    }
+
+    TEST(Reduction, HeldBackProgress_MainThreadIsNotNotified)
+    {
+      AsyncTaskLog<PQ> at;
+      at.setProgressReduction(AsyncTaskProgressReduction{ 0, std::chrono::hours(1) });
+      at.pause = std::chrono::milliseconds(-1);
+      at.enableStats();
+      at.execute(10);
+      EXPECT_FALSE(at.waitForUpdate(std::chrono::milliseconds(50)));
+      EXPECT_EQ(0, at.getPendingCallbackCount());
+
+      at.release.set_value();
+      for (size_t nBudget = 10; !at.dispatchCallbacks(nBudget); nBudget = 10)
+        Wait(std::chrono::milliseconds(1));
+
+      EXPECT_EQ(std::vector<Lines>({ Iota(0, 10) }), at.vProgress);
+
+      auto const stats = at.getStats();
+      ASSERT_TRUE(stats.has_value());
+      EXPECT_EQ(10, stats->nStored);
+      EXPECT_EQ(9, stats->nCoalesced);
+      EXPECT_EQ(1, stats->nQueueHighWater);
+    }
+
+    TEST(Reduction, Cancelled_AccumulatorIsDropped)
+    {
+      AsyncTaskLog<PQ> at;
+      at.setProgressReduction(AsyncTaskProgressReduction{ 100 });
+      at.pause = std::chrono::milliseconds(-1);
+      at.enableStats();
+      at.execute(10);
+      Wait(std::chrono::milliseconds(20));
+      at.cancel();
+      at.release.set_value();
+      at.get();
+
+      auto const stats = at.getStats();
+      ASSERT_TRUE(stats.has_value());
+      EXPECT_EQ(10, stats->nStored);
+      EXPECT_EQ(0, stats->nQueueHighWater);
+    }
+  }
+
+  namespace Streaming
+  {
+    struct Row
+    {
+      size_t index = 0;
+      std::unique_ptr<std::vector<int>> data;
+    };
+
+    template<typename AsyncTaskT>
+    class AsyncTaskRows : public AsyncTaskStreaming<Row, AsyncTaskT>
+    {
+    public:
+      std::vector<size_t> vIndex;
+      std::vector<int const*> vDataPublished;
+      std::vector<int const*> vDataHandled;
+      std::vector<int> vProgress;
+      bool isPostExecuted = false;
+      bool isPartialResultAfterPostExecute = false;
+      bool isParallel = false;
+      std::promise<void> release;
+      bool isReleaseNeeded = false;
+
+      using AsyncTaskStreaming<Row, AsyncTaskT>::AsyncTaskStreaming;
+
+    protected:
+      int doInBackground(int const& n) override
+      {
+        if (isParallel)
+        {
+          this->parallelFor(0, size_t(n), 1, [this](size_t i) { this->publishPartialResult(Row{ i, std::make_unique<std::vector<int>>(10, int(i)) }); });
+          return n;
+        }
+
+        for (int i = 0; i < n; ++i)
+        {
+          auto row = Row{ size_t(i), std::make_unique<std::vector<int>>(10, i) };
+          vDataPublished.push_back(row.data->data());
+          this->publishPartialResult(std::move(row));
+          this->publishProgress(i);
+        }
+
+        if (isReleaseNeeded)
+          release.get_future().wait();
+
+        return n;
+      }
+
+      void onPartialResult(Row&& row) override
+      {
+        isPartialResultAfterPostExecute |= isPostExecuted;
+        vIndex.push_back(row.index);
+        vDataHandled.push_back(row.data->data());
+      }
+
+      void onProgressUpdate(int const& progress) override { vProgress.push_back(progress); }
+      void onPostExecute(int const&) override { isPostExecuted = true; }
+    };
+
+    TEST(Streaming, onCallbackLoop_ChunksAreMovedInOrder)
+    {
+      AsyncTaskRows<AsyncTask<int, int, int>> at;
+      at.execute(10);
+      while (!at.onCallbackLoop())
+        Wait(std::chrono::milliseconds(1));
+
+      EXPECT_EQ(std::vector<size_t>({ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 }), at.vIndex);
+      EXPECT_EQ(at.vDataPublished, at.vDataHandled);
+      EXPECT_TRUE(at.isPostExecuted);
+      EXPECT_FALSE(at.isPartialResultAfterPostExecute);
+    }
+
+    TEST(Streaming, get_RemainingChunksAreHandledBeforePostExecute)
+    {
+      AsyncTaskRows<AsyncTaskPQ<int, int, int>> at;
+      at.execute(10);
+      EXPECT_EQ(10, at.get());
+      EXPECT_EQ(10, at.vIndex.size());
+      EXPECT_FALSE(at.isPartialResultAfterPostExecute);
+    }
+
+    TEST(Streaming, dispatchCallbacks_ChunksAreCountedFirstInTheBudget)
+    {
+      AsyncTaskRows<AsyncTaskPQ<int, int, int>> at;
+      at.execute(5);
+      while (at.getPendingCallbackCount() < 11)
+        Wait(std::chrono::milliseconds(1));
+
+      size_t nBudget = 3;
+      EXPECT_FALSE(at.dispatchCallbacks(nBudget));
+      EXPECT_EQ(3, at.vIndex.size());
+      EXPECT_TRUE(at.vProgress.empty());
+
+      nBudget = 5;
+      EXPECT_FALSE(at.dispatchCallbacks(nBudget));
+      EXPECT_EQ(5, at.vIndex.size());
+      EXPECT_EQ(3, at.vProgress.size());
+
+      nBudget = 3;
+      EXPECT_TRUE(at.dispatchCallbacks(nBudget));
+      EXPECT_EQ(std::vector<int>({ 0, 1, 2, 3, 4 }), at.vProgress);
+      EXPECT_TRUE(at.isPostExecuted);
+    }
+
+    TEST(Streaming, Cancelled_ChunksAreNotHandled)
+    {
+      AsyncTaskRows<AsyncTask<int, int, int>> at;
+      at.isReleaseNeeded = true;
+      at.execute(10);
+      while (at.getPendingCallbackCount() < 10)
+        Wait(std::chrono::milliseconds(1));
+
+      at.cancel();
+      at.release.set_value();
+      while (!at.onCallbackLoop())
+        Wait(std::chrono::milliseconds(1));
+
+      EXPECT_TRUE(at.vIndex.empty());
+      EXPECT_FALSE(at.isPostExecuted);
+    }
+
+    TEST(Streaming, parallelFor_EveryChunkIsHandled)
+    {
+      AsyncTaskThreadPool pool(4);
+      AsyncTaskRows<AsyncTask<int, int, int>> at(pool);
+      at.isParallel = true;
+      at.execute(100);
+      while (!at.onCallbackLoop())
+        Wait(std::chrono::milliseconds(1));
+
+      std::sort(at.vIndex.begin(), at.vIndex.end());
+      ASSERT_EQ(100, at.vIndex.size());
+      for (size_t i = 0; i < 100; ++i)
+        ASSERT_EQ(i, at.vIndex[i]);
+    }
+  }
+
+  namespace ResultCache
+  {
+    using Cache = AsyncTaskResultCache<int, int>;
+
+    class AsyncTaskSquare : public AsyncTask<int, int, int>
+    {
+    public:
+      std::atomic<int>& nRun;
+      std::shared_future<void> gate;
+      bool isPreExecuted = false;
+      std::optional<int> resultPosted;
+      bool isCancelHandled = false;
+
+      AsyncTaskSquare(std::atomic<int>& nRun, std::shared_future<void> gate = {}) : nRun(nRun), gate(std::move(gate)) {}
+
+    protected:
+      int doInBackground(int const& n) override
+      {
+        ++nRun;
+        if (gate.valid())
+          while (gate.wait_for(std::chrono::milliseconds(1)) != std::future_status::ready && !isCancelled())
+            ;
+
+        return n * n;
+      }
+
+      void onPreExecute() override { isPreExecuted = true; }
+      void onPostExecute(int const& result) override { resultPosted = result; }
+      void onCancelled() override { isCancelHandled = true; }
+    };
+
+    static int RunSquare(Cache& cache, std::atomic<int>& nRun, int n)
+    {
+      AsyncTaskSquare at(nRun);
+      at.setResultCache(&cache);
+      at.execute(n);
+      while (!at.onCallbackLoop())
+        Wait(std::chrono::milliseconds(1));
+
+      EXPECT_TRUE(at.isPreExecuted);
+      EXPECT_EQ(at.get(), at.resultPosted.value_or(-1));
+      return at.get();
+    }
+
+    TEST(ResultCache, Hit_WorkerIsSkipped)
+    {
+      auto cache = Cache(8);
+      auto nRun = std::atomic<int>{ 0 };
+      EXPECT_EQ(9, RunSquare(cache, nRun, 3));
+      EXPECT_EQ(9, RunSquare(cache, nRun, 3));
+      EXPECT_EQ(16, RunSquare(cache, nRun, 4));
+      EXPECT_EQ(2, nRun.load());
+      EXPECT_EQ(2, cache.size());
+
+      cache.clear();
+      EXPECT_EQ(9, RunSquare(cache, nRun, 3));
+      EXPECT_EQ(3, nRun.load());
+    }
+
+    TEST(ResultCache, MaxEntries_LeastRecentlyUsedIsEvicted)
+    {
+      auto cache = Cache(2);
+      auto nRun = std::atomic<int>{ 0 };
+      RunSquare(cache, nRun, 1);
+      RunSquare(cache, nRun, 2);
+      RunSquare(cache, nRun, 1); // 1 is used again
+      RunSquare(cache, nRun, 3); // 2 is evicted
+      EXPECT_EQ(3, nRun.load());
+
+      RunSquare(cache, nRun, 1);
+      EXPECT_EQ(3, nRun.load());
+      RunSquare(cache, nRun, 2);
+      EXPECT_EQ(4, nRun.load());
+      EXPECT_EQ(2, cache.size());
+    }
+
+    TEST(ResultCache, MaxBytes_ResultsAreMeasured)
+    {
+      auto cache = Cache(100, 10, [](int const& result) { return size_t(result); });
+      auto nRun = std::atomic<int>{ 0 };
+      RunSquare(cache, nRun, 2); // 4 bytes
+      RunSquare(cache, nRun, 1); // 1 byte
+      RunSquare(cache, nRun, 3); // 9 bytes: 2 is evicted
+      EXPECT_EQ(2, cache.size());
+      RunSquare(cache, nRun, 3);
+      EXPECT_EQ(3, nRun.load());
+
+      RunSquare(cache, nRun, 4); // 16 bytes: it is not kept, 1 and 3 are evicted too
+      EXPECT_EQ(0, cache.size());
+    }
+
+    TEST(ResultCache, CustomHash_KeysAreStillCompared)
+    {
+      auto cache = Cache(8, std::numeric_limits<size_t>::max(), nullptr, [](int const&) { return size_t(0); });
+      auto nRun = std::atomic<int>{ 0 };
+      EXPECT_EQ(4, RunSquare(cache, nRun, 2));
+      EXPECT_EQ(9, RunSquare(cache, nRun, 3));
+      EXPECT_EQ(4, RunSquare(cache, nRun, 2));
+      EXPECT_EQ(2, nRun.load());
+    }
+
+    struct Unhashable
+    {
+      int i = 0;
+      bool operator==(Unhashable const& other) const { return i == other.i; }
+    };
+
+    TEST(ResultCache, Unhashable_fnHashIsGiven_Cached)
+    {
+      using UnhashableCache = AsyncTaskResultCache<int, Unhashable>;
+      auto cache = UnhashableCache(8, std::numeric_limits<size_t>::max(), nullptr, [](Unhashable const& param) { return size_t(param.i); });
+      auto resultHit = std::optional<int>();
+      EXPECT_EQ(UnhashableCache::Acquisition::Lead, cache.acquire({ Unhashable{ 1 } }, {}, resultHit));
+      cache.complete({ Unhashable{ 1 } }, 10);
+      EXPECT_EQ(UnhashableCache::Acquisition::Hit, cache.acquire({ Unhashable{ 1 } }, {}, resultHit));
+      EXPECT_EQ(10, resultHit.value_or(-1));
+    }
+
+    TEST(ResultCache, Unhashable_fnHashIsNull_Throws)
+    {
+      using UnhashableCache = AsyncTaskResultCache<int, Unhashable>;
+      EXPECT_THROW(UnhashableCache(8, std::numeric_limits<size_t>::max(), nullptr, nullptr), std::invalid_argument);
+    }
+
+    TEST(ResultCache, InFlight_ComputationIsShared)
+    {
+      auto cache = Cache(8);
+      auto nRun = std::atomic<int>{ 0 };
+      auto gate = std::promise<void>();
+      auto const gateShared = gate.get_future().share();
+
+      AsyncTaskGroup group;
+      auto& at1 = group.add(std::make_unique<AsyncTaskSquare>(nRun, gateShared));
+      auto& at2 = group.add(std::make_unique<AsyncTaskSquare>(nRun, gateShared));
+      auto& at3 = group.add(std::make_unique<AsyncTaskSquare>(nRun, gateShared));
+      for (auto* at : { &at1, &at2, &at3 })
+      {
+        at->setResultCache(&cache);
+        at->execute(5);
+      }
+
+      EXPECT_FALSE(group.whenAll(std::chrono::milliseconds(20)));
+      gate.set_value();
+      group.whenAll();
+      EXPECT_EQ(1, nRun.load());
+      for (auto* at : { &at1, &at2, &at3 })
+        EXPECT_EQ(25, at->resultPosted.value_or(-1));
+    }
+
+    TEST(ResultCache, InFlight_CancelledComputationIsTakenOver)
+    {
+      auto cache = Cache(8);
+      auto nRun = std::atomic<int>{ 0 };
+      auto gate = std::promise<void>();
+
+      AsyncTaskSquare at1(nRun, gate.get_future().share());
+      AsyncTaskSquare at2(nRun);
+      at1.setResultCache(&cache);
+      at2.setResultCache(&cache);
+      at1.execute(6);
+      while (nRun.load() == 0)
+        Wait(std::chrono::milliseconds(1));
+
+      at2.execute(6);
+      at1.cancel();
+      while (!at1.onCallbackLoop() || !at2.onCallbackLoop())
+        Wait(std::chrono::milliseconds(1));
+
+      EXPECT_TRUE(at1.isCancelHandled);
+      EXPECT_EQ(36, at2.resultPosted.value_or(-1));
+      EXPECT_EQ(2, nRun.load());
+      EXPECT_EQ(1, cache.size());
+      gate.set_value();
+    }
+
+    TEST(ResultCache, InFlight_CancelledWaiterIsFinished)
+    {
+      auto cache = Cache(8);
+      auto nRun = std::atomic<int>{ 0 };
+      auto gate = std::promise<void>();
+      auto const gateShared = gate.get_future().share();
+
+      AsyncTaskSquare at1(nRun, gateShared);
+      AsyncTaskSquare at2(nRun, gateShared);
+      at1.setResultCache(&cache);
+      at2.setResultCache(&cache);
+      at1.execute(7);
+      at2.execute(7);
+      at2.cancel();
+      while (!at2.onCallbackLoop())
+        Wait(std::chrono::milliseconds(1));
+
+      EXPECT_TRUE(at2.isCancelHandled);
+      EXPECT_EQ(AsyncTaskSquare::Status::RUNNING, at1.getStatus());
+
+      gate.set_value();
+      EXPECT_EQ(49, at1.get());
+      EXPECT_EQ(1, nRun.load());
+    }
+  }
+
+  namespace LaunchPolicy
+  {
+    template<typename AsyncTaskT = AsyncTask<int, int, int>>
+    class AsyncTaskProbe : public AsyncTaskT
+    {
+    public:
+      std::atomic<bool> isRun = { false };
+      std::thread::id idThread;
+      bool isLoopUntilCancelled = false;
+      bool isCancelHandled = false;
+
+      using AsyncTaskT::AsyncTaskT;
+
+    protected:
+      int doInBackground(int const& n) override
+      {
+        idThread = std::this_thread::get_id();
+        isRun.store(true);
+        for (int i = 0; isLoopUntilCancelled ? !this->isCancelled() : i < n; ++i)
+        {
+          this->publishProgress(i);
+          if (isLoopUntilCancelled)
+            Wait(std::chrono::milliseconds(1));
+        }
+
+        return n;
+      }
+
+      void onCancelled() override { isCancelHandled = true; }
+    };
+
+    static AsyncTaskLaunchOptions Policy(AsyncTaskLaunchPolicy policy) { return AsyncTaskLaunchOptions{ AsyncTaskPriority::Normal, std::nullopt, policy }; }
+
+    TEST(LaunchPolicy, Deferred_LaunchedByOnCallbackLoop)
+    {
+      AsyncTaskProbe<> at;
+      at.execute(Policy(AsyncTaskLaunchPolicy::Deferred), 3);
+      Wait(std::chrono::milliseconds(20));
+      EXPECT_FALSE(at.isRun.load());
+      EXPECT_EQ(AsyncTaskProbe<>::Status::RUNNING, at.getStatus());
+
+      while (!at.onCallbackLoop())
+        Wait(std::chrono::milliseconds(1));
+
+      EXPECT_TRUE(at.isRun.load());
+      EXPECT_EQ(3, at.get());
+    }
+
+    TEST(LaunchPolicy, Deferred_LaunchedByGet)
+    {
+      AsyncTaskProbe<> at;
+      at.execute(Policy(AsyncTaskLaunchPolicy::Deferred), 3);
+      EXPECT_EQ(3, at.get());
+      EXPECT_TRUE(at.isRun.load());
+    }
+
+    TEST(LaunchPolicy, Deferred_CancelledBeforeLaunch_FinishedWithoutRun)
+    {
+      AsyncTaskProbe<> at;
+      at.execute(Policy(AsyncTaskLaunchPolicy::Deferred), 3);
+      at.cancel();
+      EXPECT_TRUE(at.onCallbackLoop());
+      EXPECT_TRUE(at.isCancelHandled);
+      EXPECT_FALSE(at.isRun.load());
+    }
+
+    TEST(LaunchPolicy, Deferred_NotLaunched_DtorDoesNotWait)
+    {
+      AsyncTaskProbe<> at;
+      at.execute(Policy(AsyncTaskLaunchPolicy::Deferred), 3);
+    }
+
+    TEST(LaunchPolicy, Deferred_LaunchedByGroupWhenAll)
+    {
+      AsyncTaskGroup group;
+      auto& at1 = group.add(std::make_unique<AsyncTaskProbe<>>());
+      auto& at2 = group.add(std::make_unique<AsyncTaskProbe<>>());
+      at1.execute(Policy(AsyncTaskLaunchPolicy::Deferred), 1);
+      at2.execute(Policy(AsyncTaskLaunchPolicy::Deferred), 2);
+      EXPECT_FALSE(group.onCallbackLoop());
+
+      group.whenAll();
+      EXPECT_TRUE(at1.isRun.load());
+      EXPECT_TRUE(at2.isRun.load());
+    }
+
+    TEST(LaunchPolicy, Inline_RunOnTheCallingThread)
+    {
+      AsyncTaskProbe<> at;
+      at.execute(Policy(AsyncTaskLaunchPolicy::Inline), 3);
+      EXPECT_EQ(std::this_thread::get_id(), at.idThread);
+      EXPECT_TRUE(at.onCallbackLoop());
+      EXPECT_EQ(3, at.get());
+    }
+
+    TEST(LaunchPolicy, Inline_BlockingRingBuffer_NotBlocked)
+    {
+      AsyncTaskProbe<AsyncTaskPQRingBuffer<2, AsyncTaskOverflowPolicy::Block, int, int, int>> at;
+      at.execute(Policy(AsyncTaskLaunchPolicy::Inline), 100);
+      EXPECT_TRUE(at.onCallbackLoop());
+      EXPECT_EQ(100, at.get());
+    }
+
+    TEST(LaunchPolicy, Speculative_NoIdleWorker_FinishedWithoutRun)
+    {
+      AsyncTaskThreadPool pool(1);
+      AsyncTaskProbe<> atBusy(pool);
+      atBusy.isLoopUntilCancelled = true;
+      atBusy.execute(0);
+      while (!atBusy.isRun.load())
+        Wait(std::chrono::milliseconds(1));
+
+      EXPECT_FALSE(pool.hasIdleWorkers());
+      AsyncTaskProbe<> at(pool);
+      at.execute(Policy(AsyncTaskLaunchPolicy::Speculative), 3);
+      EXPECT_TRUE(at.onCallbackLoop());
+      EXPECT_TRUE(at.isCancelHandled);
+      EXPECT_FALSE(at.isRun.load());
+
+      atBusy.cancel();
+      atBusy.get();
+      while (!pool.hasIdleWorkers())
+        Wait(std::chrono::milliseconds(1));
+
+      AsyncTaskProbe<> atIdle(pool);
+      atIdle.execute(Policy(AsyncTaskLaunchPolicy::Speculative), 3);
+      EXPECT_EQ(3, atIdle.get());
+      EXPECT_TRUE(atIdle.isRun.load());
+      EXPECT_FALSE(atIdle.isCancelHandled);
+    }
+
+    TEST(LaunchPolicy, Speculative_PendingJob_RunningOneIsCancelled)
+    {
+      AsyncTaskThreadPool pool(1);
+      AsyncTaskProbe<> atSpeculative(pool);
+      atSpeculative.isLoopUntilCancelled = true;
+      atSpeculative.execute(Policy(AsyncTaskLaunchPolicy::Speculative), 0);
+      while (!atSpeculative.isRun.load())
+        Wait(std::chrono::milliseconds(1));
+
+      AsyncTaskProbe<> at(pool);
+      at.execute(3);
+      EXPECT_EQ(3, at.get());
+      while (!atSpeculative.onCallbackLoop())
+        Wait(std::chrono::milliseconds(1));
+
+      EXPECT_TRUE(atSpeculative.isCancelHandled);
+    }
+  }
+
+  namespace Affinity
+  {
+    class AsyncTaskWhere : public AsyncTask<int, int, int>
+    {
+    public:
+      AsyncTaskThreadPool const& pool;
+      std::optional<size_t> core;
+      std::atomic<bool>* isReleased = nullptr;
+
+      explicit AsyncTaskWhere(AsyncTaskThreadPool& pool) : AsyncTask<int, int, int>(pool), pool(pool) {}
+
+    protected:
+      int doInBackground(int const& n) override
+      {
+        core = pool.getCurrentCore();
+        while (isReleased && !isReleased->load())
+          Wait(std::chrono::milliseconds(1));
+
+        return n;
+      }
+    };
+
+    static AsyncTaskLaunchOptions Affinity(AsyncTaskAffinity affinity) { return AsyncTaskLaunchOptions{ AsyncTaskPriority::Normal, std::nullopt, AsyncTaskLaunchPolicy::Eager, std::move(affinity) }; }
+
+    static AsyncTaskWorkerLayout TwoNodes() { return AsyncTaskWorkerLayout{ { { 10, 11 }, { 20, 21 } } }; }
+
+    TEST(Affinity, Layout_Uniform)
+    {
+      auto const layout = AsyncTaskWorkerLayout::uniform(3);
+      EXPECT_EQ((std::vector<std::vector<size_t>>{ { 0, 1, 2 } }), layout.nodes);
+      EXPECT_EQ(nullptr, layout.fnPin);
+
+      AsyncTaskThreadPool pool(layout);
+      EXPECT_EQ(3, pool.size());
+      EXPECT_EQ(1, pool.getNodeCount());
+      EXPECT_FALSE(pool.getCurrentCore().has_value());
+    }
+
+    TEST(Affinity, Layout_Detect_PoolRuns)
+    {
+      auto const layout = AsyncTaskNumaTopology::detect();
+      ASSERT_FALSE(layout.nodes.empty());
+      EXPECT_NE(nullptr, layout.fnPin);
+
+      AsyncTaskThreadPool pool(layout);
+      EXPECT_EQ(layout.nodes.size(), pool.getNodeCount());
+      AsyncTaskWhere at(pool);
+      at.execute(1);
+      EXPECT_EQ(1, at.get());
+      EXPECT_TRUE(at.core.has_value());
+    }
+
+    TEST(Affinity, ExclusiveCore_RunOnThatWorker)
+    {
+      AsyncTaskThreadPool pool(4);
+      auto vTask = std::vector<std::unique_ptr<AsyncTaskWhere>>{};
+      for (int i = 0; i < 16; ++i)
+      {
+        vTask.emplace_back(std::make_unique<AsyncTaskWhere>(pool));
+        vTask.back()->execute(Affinity({ AsyncTaskAffinity::anyNode, { 2 }, true }), i);
+      }
+
+      for (auto& pTask : vTask)
+      {
+        pTask->get();
+        EXPECT_EQ(2, pTask->core.value());
+      }
+    }
+
+    TEST(Affinity, ExclusiveNode_RunOnItsWorkers)
+    {
+      AsyncTaskThreadPool pool(TwoNodes());
+      EXPECT_EQ(2, pool.getNodeCount());
+
+      auto vTask = std::vector<std::unique_ptr<AsyncTaskWhere>>{};
+      for (int i = 0; i < 16; ++i)
+      {
+        vTask.emplace_back(std::make_unique<AsyncTaskWhere>(pool));
+        vTask.back()->execute(Affinity({ 1, {}, true }), i);
+      }
+
+      for (auto& pTask : vTask)
+      {
+        pTask->get();
+        auto const core = pTask->core.value();
+        EXPECT_TRUE(core == 20 || core == 21);
+      }
+    }
+
+    TEST(Affinity, BusyNode_StolenByTheOtherNode)
+    {
+      AsyncTaskThreadPool pool(TwoNodes());
+      std::atomic<bool> isReleased = { false };
+      auto vBusy = std::vector<std::unique_ptr<AsyncTaskWhere>>{};
+      for (size_t const core : { 20, 21 })
+      {
+        vBusy.emplace_back(std::make_unique<AsyncTaskWhere>(pool));
+        vBusy.back()->isReleased = &isReleased;
+        vBusy.back()->execute(Affinity({ AsyncTaskAffinity::anyNode, { core }, true }), 0);
+      }
+
+      AsyncTaskWhere at(pool);
+      at.execute(Affinity({ 1, {}, false }), 1);
+      EXPECT_EQ(1, at.get());
+      auto const core = at.core.value();
+      EXPECT_TRUE(core == 10 || core == 11);
+
+      isReleased.store(true);
+      for (auto& pTask : vBusy)
+        EXPECT_EQ(0, pTask->get());
+    }
+
+    TEST(Affinity, UnknownCore_Ignored)
+    {
+      AsyncTaskThreadPool pool(2);
+      AsyncTaskWhere at(pool);
+      at.execute(Affinity({ 7, { 99 }, true }), 1);
+      EXPECT_EQ(1, at.get());
+    }
+
+    TEST(Affinity, Group_PinnedToOneWorker)
+    {
+      AsyncTaskThreadPool pool(4);
+      AsyncTaskGroup group;
+      auto& at1 = group.add(std::make_unique<AsyncTaskWhere>(pool));
+      group.setAffinity({ AsyncTaskAffinity::anyNode, { 3 }, true });
+      auto& at2 = group.add(std::make_unique<AsyncTaskWhere>(pool));
+      at1.execute(1);
+      at2.execute(2);
+      group.whenAll();
+      EXPECT_EQ(3, at1.core.value());
+      EXPECT_EQ(3, at2.core.value());
+    }
+
+    TEST(Affinity, Group_MemberIsRunning_Throw)
+    {
+      AsyncTaskThreadPool pool(2);
+      AsyncTaskGroup group;
+      auto& at = group.add(std::make_unique<AsyncTaskWhere>(pool));
+      at.execute(1);
+      EXPECT_THROW(group.setAffinity({ 0, {}, false }), AsyncTaskIllegalStateException);
+      group.whenAll();
+    }
+
+    TEST(Affinity, Dtor_ExclusiveJobsAreRun)
+    {
+      struct Job : AsyncTaskJob
+      {
+        AsyncTaskAffinity affinity{ AsyncTaskAffinity::anyNode, { 0 }, true };
+        std::atomic<int>* nRun = nullptr;
+        void run() noexcept override { ++*nRun; }
+        AsyncTaskAffinity const* getAffinity() const noexcept override { return &affinity; }
+      };
+
+      std::atomic<int> nRun = { 0 };
+      auto vJob = std::vector<Job>(100);
+      {
+        AsyncTaskThreadPool pool(3);
+        for (auto& job : vJob)
+        {
+          job.nRun = &nRun;
+          pool.submit(job);
+        }
+      }
+      EXPECT_EQ(100, nRun.load());
+    }
+  }
+
+  namespace Timeout
+  {
+    using namespace std::chrono_literals;
+
+    // It publishes n progress, then it waits for the release
+    class AsyncTaskGate : public AsyncTask<int, int, int>
+    {
+    public:
+      std::atomic<bool> isReleased = { false };
+      bool isThrow = false;
+      int nProgressHandled = 0;
+      bool isPostExecuted = false;
+
+    protected:
+      int doInBackground(int const& n) override
+      {
+        for (int i = 0; i < n; ++i)
+          publishProgress(i);
+
+        while (!isReleased.load() && !isCancelled())
+          Wait(1ms);
+
+        if (isThrow)
+          throw std::runtime_error("gate");
+
+        return n;
+      }
+
+      void onProgressUpdate(int const&) override { ++nProgressHandled; }
+      void onPostExecute(int const&) override { isPostExecuted = true; }
+    };
+
+    static std::chrono::steady_clock::duration Elapsed(std::chrono::steady_clock::time_point const& t0) { return std::chrono::steady_clock::now() - t0; }
+
+    TEST(Timeout, get_for_NotFinished_nullopt)
+    {
+      AsyncTaskGate at;
+      at.execute(0);
+      auto const t0 = std::chrono::steady_clock::now();
+      EXPECT_FALSE(at.get_for(20ms).has_value());
+      EXPECT_GE(Elapsed(t0), 20ms);
+      EXPECT_EQ(AsyncTaskGate::Status::RUNNING, at.getStatus());
+
+      at.isReleased.store(true);
+      EXPECT_EQ(0, at.get_for(60s).value());
+    }
+
+    TEST(Timeout, get_for_FinishedMeanwhile_WokenUpByTheFinish)
+    {
+      AsyncTaskGate at;
+      at.execute(5);
+      auto const t0 = std::chrono::steady_clock::now();
+      auto releaser = std::thread([&] { Wait(20ms); at.isReleased.store(true); });
+      auto const result = at.get_for(60s);
+      releaser.join();
+
+      ASSERT_TRUE(result.has_value());
+      EXPECT_EQ(5, *result);
+      EXPECT_LT(Elapsed(t0), 30s);
+      EXPECT_TRUE(at.isPostExecuted);
+      EXPECT_EQ(AsyncTaskGate::Status::FINISHED, at.getStatus());
+    }
+
+    TEST(Timeout, get_until_Finished_Result)
+    {
+      AsyncTaskGate at;
+      at.isReleased.store(true);
+      at.execute(1);
+      at.get();
+      EXPECT_EQ(1, at.get_until(std::chrono::steady_clock::now()).value());
+    }
+
+    TEST(Timeout, get_for_Exception_Rethrow)
+    {
+      AsyncTaskGate at;
+      at.isThrow = true;
+      at.isReleased.store(true);
+      at.execute(0);
+      EXPECT_THROW(at.get_for(60s), std::runtime_error);
+    }
+
+    TEST(Timeout, get_for_Deferred_Launched)
+    {
+      AsyncTaskGate at;
+      at.isReleased.store(true);
+      at.execute(AsyncTaskLaunchOptions{ AsyncTaskPriority::Normal, std::nullopt, AsyncTaskLaunchPolicy::Deferred }, 2);
+      EXPECT_EQ(2, at.get_for(60s).value());
+    }
+
+    TEST(Timeout, onCallbackLoop_NoUpdate_WaitsUntilTimeout)
+    {
+      AsyncTaskGate at;
+      at.execute(0);
+      at.onCallbackLoop();
+      auto const t0 = std::chrono::steady_clock::now();
+      EXPECT_FALSE(at.onCallbackLoop(20ms));
+      EXPECT_GE(Elapsed(t0), 20ms);
+
+      at.isReleased.store(true);
+      EXPECT_EQ(0, at.get());
+    }
+
+    TEST(Timeout, onCallbackLoop_Progress_WokenUp)
+    {
+      AsyncTaskGate at;
+      at.execute(1);
+      auto const t0 = std::chrono::steady_clock::now();
+      while (at.nProgressHandled == 0)
+        EXPECT_FALSE(at.onCallbackLoop(60s));
+
+      EXPECT_LT(Elapsed(t0), 30s);
+      at.isReleased.store(true);
+      while (!at.onCallbackLoop(60s))
+        ;
+
+      EXPECT_LT(Elapsed(t0), 30s);
+      EXPECT_TRUE(at.isPostExecuted);
+    }
+
+    TEST(Timeout, onCallbackLoop_Cancelled_WokenUp)
+    {
+      AsyncTaskGate at;
+      at.execute(0);
+      auto canceller = std::thread([&] { Wait(20ms); at.cancel(); });
+      auto const t0 = std::chrono::steady_clock::now();
+      while (!at.onCallbackLoop(60s))
+        ;
+
+      canceller.join();
+      EXPECT_LT(Elapsed(t0), 30s);
+      EXPECT_TRUE(at.isCancelled());
+    }
+
+    TEST(Timeout, Group_onCallbackLoop_Finished)
+    {
+      AsyncTaskGroup group;
+      auto& at1 = group.add(std::make_unique<AsyncTaskGate>());
+      auto& at2 = group.add(std::make_unique<AsyncTaskGate>());
+      at1.isReleased.store(true);
+      at2.isReleased.store(true);
+      at1.execute(3);
+      at2.execute(4);
+      auto const t0 = std::chrono::steady_clock::now();
+      while (!group.onCallbackLoop(60s))
+        ;
+
+      EXPECT_LT(Elapsed(t0), 30s);
+      EXPECT_TRUE(group.onCallbackLoop(60s));
+      EXPECT_EQ(3, at1.get());
+      EXPECT_EQ(4, at2.get());
+    }
+  }
+
+  namespace Broadcast
+  {
+    using namespace std::chrono_literals;
+    using Broadcast = AsyncTaskProgressBroadcast<int>;
+
+    // It publishes 0..n-1
+    class AsyncTaskCounter : public AsyncTask<int, int, int>
+    {
+    public:
+      int nProgressHandled = 0;
+
+      void handleProgressLeft() { this->handleProgress(); }
+
+    protected:
+      int doInBackground(int const& n) override
+      {
+        for (int i = 0; i < n; ++i)
+          publishProgress(i);
+
+        return n;
+      }
+
+      void onProgressUpdate(int const&) override { ++nProgressHandled; }
+    };
+
+    static std::vector<Broadcast::Snapshot> PollAll(Broadcast::Subscription& subscription)
+    {
+      auto vSnapshot = std::vector<Broadcast::Snapshot>();
+      subscription.poll([&](Broadcast::Snapshot const& snapshot) { vSnapshot.push_back(snapshot); });
+      return vSnapshot;
+    }
+
+    TEST(Broadcast, publish_TwoSubscribers_SameSnapshotsInOrder)
+    {
+      Broadcast broadcast;
+      auto s1 = broadcast.subscribe();
+      auto s2 = broadcast.subscribe();
+      for (int i = 0; i < 5; ++i)
+        broadcast.publish(i);
+
+      auto const v1 = PollAll(s1);
+      auto const v2 = PollAll(s2);
+      ASSERT_EQ(5, v1.size());
+      EXPECT_EQ(v1, v2);
+      for (int i = 0; i < 5; ++i)
+        EXPECT_EQ(i, *v1[i]);
+
+      EXPECT_EQ(0, s1.getPendingCount());
+      EXPECT_EQ(0, s1.getDroppedCount());
+    }
+
+    TEST(Broadcast, publish_SlowSubscriber_OverflowIsBoundedAndCounted)
+    {
+      Broadcast broadcast(4);
+      auto subscription = broadcast.subscribe();
+      for (int i = 0; i < 10; ++i)
+        broadcast.publish(i);
+
+      EXPECT_EQ(4, subscription.getPendingCount());
+      auto const v = PollAll(subscription);
+      ASSERT_EQ(4, v.size());
+      EXPECT_EQ(6, *v.front());
+      EXPECT_EQ(9, *v.back());
+      EXPECT_EQ(6, subscription.getDroppedCount());
+    }
+
+    TEST(Broadcast, poll_nMax_RestIsKept)
+    {
+      Broadcast broadcast;
+      auto subscription = broadcast.subscribe();
+      for (int i = 0; i < 5; ++i)
+        broadcast.publish(i);
+
+      auto v = std::vector<int>();
+      EXPECT_EQ(2, subscription.poll([&](Broadcast::Snapshot const& snapshot) { v.push_back(*snapshot); }, 2));
+      EXPECT_EQ(3, subscription.getPendingCount());
+      EXPECT_EQ(3, subscription.poll([&](Broadcast::Snapshot const& snapshot) { v.push_back(*snapshot); }));
+      EXPECT_EQ(std::vector<int>({ 0, 1, 2, 3, 4 }), v);
+    }
+
+    TEST(Broadcast, subscribe_Late_OnlyNewSnapshotsAndLatest)
+    {
+      Broadcast broadcast;
+      EXPECT_EQ(nullptr, broadcast.getLatest());
+      broadcast.publish(1);
+      broadcast.publish(2);
+
+      auto subscription = broadcast.subscribe();
+      EXPECT_EQ(0, subscription.getPendingCount());
+      EXPECT_EQ(2, *broadcast.getLatest());
+
+      broadcast.publish(3);
+      auto const v = PollAll(subscription);
+      ASSERT_EQ(1, v.size());
+      EXPECT_EQ(3, *v.front());
+      EXPECT_EQ(v.front(), broadcast.getLatest());
+    }
+
+    TEST(Broadcast, waitFor_NothingPublished_Timeout)
+    {
+      Broadcast broadcast;
+      auto const subscription = broadcast.subscribe();
+      EXPECT_FALSE(subscription.waitFor(10ms));
+    }
+
+    TEST(Broadcast, setProgressBroadcast_TaskAndObserverThreads)
+    {
+      constexpr int n = 1000;
+      Broadcast broadcast(n);
+      auto vObserved = std::vector<std::vector<int>>(2);
+      auto vObserver = std::vector<std::thread>();
+      for (auto& observed : vObserved)
+      {
+        vObserver.emplace_back([&, subscription = broadcast.subscribe()]() mutable {
+          while (observed.empty() || observed.back() != n - 1)
+            if (subscription.waitFor(10ms))
+              subscription.poll([&](Broadcast::Snapshot const& snapshot) { observed.push_back(*snapshot); });
+        });
+      }
+
+      AsyncTaskCounter at;
+      at.setProgressBroadcast(&broadcast);
+      at.execute(n);
+      while (!at.onCallbackLoop());
+      at.handleProgressLeft();
+
+      EXPECT_EQ(n, at.get());
+      for (auto& observer : vObserver)
+        observer.join();
+
+      EXPECT_GT(at.nProgressHandled, 0);
+      auto vExpected = std::vector<int>(n);
+      std::iota(vExpected.begin(), vExpected.end(), 0);
+      for (auto const& observed : vObserved)
+        EXPECT_EQ(vExpected, observed);
+    }
+
+    TEST(Broadcast, setProgressBroadcast_Throttled_FinalValueIsBroadcast)
+    {
+      Broadcast broadcast;
+      auto subscription = broadcast.subscribe();
+
+      AsyncTaskCounter at;
+      at.setProgressThrottle({ std::chrono::hours(1) });
+      at.setProgressBroadcast(&broadcast);
+      at.execute(1000);
+      at.get();
+
+      auto const v = PollAll(subscription);
+      ASSERT_FALSE(v.empty());
+      EXPECT_LT(v.size(), 1000);
+      EXPECT_EQ(999, *v.back());
+    }
+
+    TEST(Broadcast, setProgressBroadcast_Running_Throws)
+    {
+      Broadcast broadcast;
+      Timeout::AsyncTaskGate at;
+      at.execute(0);
+      EXPECT_THROW(at.setProgressBroadcast(&broadcast), AsyncTaskIllegalStateException);
+      at.isReleased.store(true);
+      EXPECT_EQ(0, at.get());
+    }
+  }
+
+#ifdef __cpp_lib_coroutine
+  namespace Coroutine
+  {
+    // Eagerly started coroutine for the tests, its result is given by a std::future
+    struct CoroutineOfTest
+    {
+      struct promise_type
+      {
+        std::promise<int> result;
+        CoroutineOfTest get_return_object() { return { result.get_future() }; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_value(int value) { result.set_value(value); }
+        void unhandled_exception() { result.set_exception(std::current_exception()); }
+      };
+
+      std::future<int> result;
+    };
+
+    class AsyncTaskDouble : public AsyncTask<int, int, int>
+    {
+    public:
+      using AsyncTask<int, int, int>::AsyncTask;
+
+    protected:
+      int doInBackground(int const& i) override
+      {
+        if (i < 0)
+          throw i;
+
+        return i * 2;
+      }
+    };
+
+    CoroutineOfTest awaitSum(AsyncTaskDouble& at1, AsyncTaskDouble& at2)
+    {
+      auto const& r1 = co_await at1;
+      auto const r2 = co_await std::move(at2);
+      co_return r1 + r2;
+    }
+
+    TEST(Coroutine, co_await_ResumedByTheExecutor)
+    {
+      AsyncTaskDouble at1, at2;
+      at1.execute(1);
+      at2.execute(2);
+      auto coro = awaitSum(at1, at2);
+      ASSERT_EQ(std::future_status::ready, coro.result.wait_for(std::chrono::seconds(10)));
+      EXPECT_EQ(6, coro.result.get());
+      EXPECT_EQ(AsyncTaskDouble::Status::FINISHED, at1.getStatus());
+    }
+
+    CoroutineOfTest awaitOne(AsyncTaskDouble& at) { co_return co_await at; }
+
+    TEST(Coroutine, co_await_Deferred_Launched)
+    {
+      AsyncTaskDouble at;
+      at.execute(AsyncTaskLaunchOptions{ AsyncTaskPriority::Normal, std::nullopt, AsyncTaskLaunchPolicy::Deferred }, 21);
+      auto coro = awaitOne(at);
+      ASSERT_EQ(std::future_status::ready, coro.result.wait_for(std::chrono::seconds(10)));
+      EXPECT_EQ(42, coro.result.get());
+    }
+
+    TEST(Coroutine, co_await_Exception_Rethrown)
+    {
+      AsyncTaskDouble at1, at2;
+      at1.execute(-1);
+      at2.execute(2);
+      auto coro = awaitSum(at1, at2);
+
+      auto isThrown = false;
+      try
+      {
+        coro.result.get();
+      }
+      catch (int e)
+      {
+        isThrown = true;
+        EXPECT_EQ(-1, e);
+      }
+      EXPECT_TRUE(isThrown);
+    }
+
+    class AsyncTaskCoSum : public AsyncTaskCo<int, int, int>
+    {
+    public:
+      std::vector<int> vProgress;
+      std::mutex* mutexOrder = nullptr;
+      std::vector<int>* vOrder = nullptr;
+      std::chrono::milliseconds stepDuration{ 0 };
+
+      using AsyncTaskCo<int, int, int>::AsyncTaskCo;
+
+    protected:
+      Coroutine doInBackgroundCo(int const& n) override
+      {
+        if (n < 0)
+          throw n;
+
+        int sum = 0;
+        for (int i = 0; i < n; ++i)
+        {
+          if (vOrder)
+          {
+            std::unique_lock<std::mutex> lock(*mutexOrder);
+            vOrder->push_back(n);
+          }
+
+          if (stepDuration.count() > 0)
+            Wait(stepDuration);
+
+          sum += i;
+          co_yield i;
+        }
+        co_return sum;
+      }
+
+      void onProgressUpdate(int const& progress) override { vProgress.push_back(progress); }
+
+    public:
+      void handleProgressLeft() { this->handleProgress(); }
+    };
+
+    TEST(Coroutine, AsyncTaskCo_co_yieldPublishes_co_returnResult)
+    {
+      AsyncTaskCoSum at;
+      at.execute(10);
+      while (!at.onCallbackLoop())
+        at.waitForUpdate(std::chrono::seconds(10));
+
+      EXPECT_EQ(45, at.get());
+      at.handleProgressLeft();
+      ASSERT_FALSE(at.vProgress.empty());
+      EXPECT_EQ(9, at.vProgress.back());
+    }
+
+    TEST(Coroutine, AsyncTaskCo_Exception_Rethrown)
+    {
+      AsyncTaskCoSum at;
+      at.execute(-1);
+
+      auto isThrown = false;
+      try
+      {
+        at.get();
+      }
+      catch (int e)
+      {
+        isThrown = true;
+        EXPECT_EQ(-1, e);
+      }
+      EXPECT_TRUE(isThrown);
+    }
+
+    TEST(Coroutine, AsyncTaskCo_OneWorkerMultiplexesTasks)
+    {
+      std::mutex mutexOrder;
+      std::vector<int> vOrder;
+      AsyncTaskThreadPool pool(1);
+      AsyncTaskCoSum at1(pool), at2(pool);
+      at1.mutexOrder = at2.mutexOrder = &mutexOrder;
+      at1.vOrder = at2.vOrder = &vOrder;
+
+      {
+        std::unique_lock<std::mutex> lock(mutexOrder); // Both tasks are queued before the first step
+        at1.execute(100);
+        at2.execute(101);
+      }
+
+      EXPECT_EQ(4950, at1.get());
+      EXPECT_EQ(5050, at2.get());
+
+      auto const itFirstOf2 = std::find(vOrder.begin(), vOrder.end(), 101);
+      auto const itLastOf1 = std::find(vOrder.rbegin(), vOrder.rend(), 100);
+      EXPECT_TRUE(itFirstOf2 < itLastOf1.base());
+    }
+
+    TEST(Coroutine, AsyncTaskCo_StartedBeforeDeadline_LaterStepsAreNotCancelled)
+    {
+      AsyncTaskThreadPool pool(1);
+      AsyncTaskCoSum at(pool), atQueued(pool);
+      at.stepDuration = std::chrono::milliseconds(30);
+      atQueued.stepDuration = std::chrono::milliseconds(100);
+
+      at.execute(AsyncTaskLaunchOptions{ AsyncTaskPriority::Normal, std::chrono::steady_clock::now() + std::chrono::milliseconds(50) }, 5);
+      atQueued.execute(1); // The steps of the at are resubmitted behind it, the deadline is passed meanwhile
+
+      EXPECT_EQ(10, at.get());
+      EXPECT_FALSE(at.isCancelled());
+      EXPECT_EQ(0, atQueued.get());
+    }
+
+    TEST(Coroutine, AsyncTaskCo_Reset_CoroutineRestarted)
+    {
+      AsyncTaskCoSum at;
+      at.execute(10);
+      EXPECT_EQ(45, at.get());
+
+      at.reset();
+      at.execute(5);
+      EXPECT_EQ(10, at.get());
+    }
+
+    TEST(Coroutine, AsyncTaskCo_Dtor_CancelledAndWaited)
+    {
+      AsyncTaskCoSum at;
+      at.execute(1 << 30);
+    }
+  }
+#endif
 }
\ No newline at end of file